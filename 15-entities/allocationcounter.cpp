@@ -0,0 +1,102 @@
+#include "loadstatistics.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+// Replacing the global allocation functions counts every operator new in
+// the program, at the cost of two thread-local increments each. Only the
+// benchmark and builds made with ALLOCATION_STATS=1 link this file, so the
+// game otherwise keeps the standard allocator.
+static bool startCounting()
+{
+    LoadStatistics::setCountingAllocations(true);
+    return true;
+}
+
+static bool counting = startCounting();
+
+void* operator new(size_t size)
+{
+    LoadStatistics::countAllocation(size);
+
+    void* memory = malloc(size > 0 ? size : 1);
+    if(memory == NULL)
+        throw bad_alloc();
+    return memory;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+// aligned_alloc needs the size to be a multiple of the alignment
+void* operator new(size_t size, align_val_t alignment)
+{
+    LoadStatistics::countAllocation(size);
+
+    size_t bytes = (size_t) alignment;
+    size_t roundedSize = (max(size, (size_t) 1) + bytes - 1) / bytes * bytes;
+#ifdef _WIN32
+    void* memory = _aligned_malloc(roundedSize, bytes);
+#else
+    void* memory = aligned_alloc(bytes, roundedSize);
+#endif
+    if(memory == NULL)
+        throw bad_alloc();
+    return memory;
+}
+
+void* operator new[](size_t size, align_val_t alignment)
+{
+    return operator new(size, alignment);
+}
+
+void operator delete(void* memory) noexcept
+{
+    free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+    free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+    free(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept
+{
+    free(memory);
+}
+
+void operator delete(void* memory, align_val_t) noexcept
+{
+#ifdef _WIN32
+    _aligned_free(memory);
+#else
+    free(memory);
+#endif
+}
+
+void operator delete[](void* memory, align_val_t alignment) noexcept
+{
+    operator delete(memory, alignment);
+}
+
+void operator delete(void* memory, size_t, align_val_t alignment) noexcept
+{
+    operator delete(memory, alignment);
+}
+
+void operator delete[](void* memory, size_t, align_val_t alignment) noexcept
+{
+    operator delete(memory, alignment);
+}
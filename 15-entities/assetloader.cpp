@@ -0,0 +1,145 @@
+#include "assetloader.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <memory>
+
+AssetLoader::AssetLoader()
+{
+    threadPool = NULL;
+    stagingBuffer = NULL;
+}
+
+void AssetLoader::setThreadPool(ThreadPool* newThreadPool)
+{
+    threadPool = newThreadPool;
+}
+
+void AssetLoader::setStagingBuffer(StagingBuffer* newStagingBuffer)
+{
+    stagingBuffer = newStagingBuffer;
+}
+
+bool AssetLoader::loadModel(Model* model)
+{
+    AssetJob job = AssetJob();
+    job.asset = model;
+    job.name = model->getFilename();
+    job.prepare = [model] { return model->prepareOBJModel(); };
+    job.upload = [model] { return model->uploadOBJModel(); };
+    job.getError = [model] { return model->getError(); };
+    return submit(job);
+}
+
+bool AssetLoader::loadTexture(Texture* texture)
+{
+    AssetJob job = AssetJob();
+    job.asset = texture;
+    job.name = texture->getFilename();
+    job.prepare = [texture] { return texture->prepareTexture(); };
+    job.upload = [texture] { return texture->uploadTexture(); };
+    job.getError = [texture] { return texture->getError(); };
+    return submit(job);
+}
+
+bool AssetLoader::loadShader(Shader* shader)
+{
+    AssetJob job = AssetJob();
+    job.asset = shader;
+    job.name = shader->getFilenames();
+    job.prepare = [shader] { return shader->prepareShader(); };
+    job.upload = [shader] { return shader->uploadShader(); };
+    job.getError = [shader] { return shader->getError(); };
+    return submit(job);
+}
+
+// An asset can only have one load in flight, since the worker writes into
+// the asset's own prepared data
+bool AssetLoader::submit(AssetJob job)
+{
+    if(find(inFlight.begin(), inFlight.end(), job.asset) != inFlight.end())
+    {
+        errorMessage = "Asset is already loading: " + job.name;
+        return false;
+    }
+    inFlight.push_back(job.asset);
+
+    shared_ptr<AssetJob> pending = make_shared<AssetJob>(job);
+    auto task = [this, pending]
+    {
+        pending->prepared = pending->prepare();
+
+        lock_guard<mutex> lock(completedMutex);
+        completed.push_back(*pending);
+    };
+
+    if(threadPool != NULL)
+    {
+        threadPool->submit(task);
+    }
+    else
+    {
+        task();
+    }
+
+    return true;
+}
+
+// Uploads assets whose worker has finished, until the staging buffer's
+// upload budget for this frame is spent. Must be called on the GL thread,
+// typically once per frame. Returns false if any asset failed, with the
+// reasons in getError().
+bool AssetLoader::processCompleted()
+{
+    TRACE_ZONE("processCompleted");
+
+    vector<AssetJob> finished;
+    {
+        lock_guard<mutex> lock(completedMutex);
+        finished.swap(completed);
+    }
+
+    errorMessage = "";
+    int i = 0;
+    for(; i < (int) finished.size(); i++)
+    {
+        if(stagingBuffer != NULL && !stagingBuffer->hasBudget())
+            break;
+
+        AssetJob& job = finished[i];
+        inFlight.erase(find(inFlight.begin(), inFlight.end(), job.asset));
+
+        if(!job.prepared || !job.upload())
+        {
+            if(!errorMessage.empty())
+            {
+                errorMessage += "\n";
+            }
+            errorMessage += job.getError();
+        }
+    }
+
+    // Whatever did not fit waits for the next frame, ahead of newer work
+    if(i < (int) finished.size())
+    {
+        lock_guard<mutex> lock(completedMutex);
+        completed.insert(completed.begin(), finished.begin() + i, finished.end());
+    }
+
+    return errorMessage.empty();
+}
+
+bool AssetLoader::isLoading(const void* asset)
+{
+    return find(inFlight.begin(), inFlight.end(), asset) != inFlight.end();
+}
+
+int AssetLoader::getPendingCount()
+{
+    return inFlight.size();
+}
+
+string AssetLoader::getError()
+{
+    return errorMessage;
+}
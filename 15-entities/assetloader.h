@@ -0,0 +1,58 @@
+#pragma once
+
+#include "model.h"
+#include "shader.h"
+#include "stagingbuffer.h"
+#include "texture.h"
+#include "threadpool.h"
+
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+struct AssetJob
+{
+    const void* asset;
+    string name;
+
+    function<bool()> prepare;
+    function<bool()> upload;
+    function<string()> getError;
+
+    bool prepared;
+};
+
+class AssetLoader
+{
+    public:
+        AssetLoader();
+
+        void setThreadPool(ThreadPool* newThreadPool);
+        void setStagingBuffer(StagingBuffer* newStagingBuffer);
+
+        bool loadModel(Model* model);
+        bool loadTexture(Texture* texture);
+        bool loadShader(Shader* shader);
+
+        bool processCompleted();
+        bool isLoading(const void* asset);
+        int getPendingCount();
+        string getError();
+
+    private:
+        ThreadPool* threadPool;
+        StagingBuffer* stagingBuffer;
+
+        // Only touched on the GL thread
+        vector<const void*> inFlight;
+
+        mutex completedMutex;
+        vector<AssetJob> completed;
+
+        string errorMessage;
+
+        bool submit(AssetJob job);
+};
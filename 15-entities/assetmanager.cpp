@@ -0,0 +1,385 @@
+#include "assetmanager.h"
+#include "trace.h"
+
+#include <SDL3/SDL.h>
+#include <filesystem>
+
+AssetManager::AssetManager()
+{
+    assetLoader = NULL;
+    threadPool = NULL;
+    geometryPool = NULL;
+    stagingBuffer = NULL;
+    fileWatcher = NULL;
+
+    modelLayout = VERTEX_LAYOUT_SEPARATE;
+    modelOptimize = false;
+    modelLods = false;
+    modelMeshlets = false;
+}
+
+void AssetManager::setAssetLoader(AssetLoader* newAssetLoader)
+{
+    assetLoader = newAssetLoader;
+}
+
+void AssetManager::setThreadPool(ThreadPool* newThreadPool)
+{
+    threadPool = newThreadPool;
+}
+
+void AssetManager::setGeometryPool(GeometryPool* newGeometryPool)
+{
+    geometryPool = newGeometryPool;
+}
+
+void AssetManager::setStagingBuffer(StagingBuffer* newStagingBuffer)
+{
+    stagingBuffer = newStagingBuffer;
+}
+
+void AssetManager::setFileWatcher(FileWatcher* newFileWatcher)
+{
+    fileWatcher = newFileWatcher;
+}
+
+void AssetManager::setModelDefaults(VertexLayout layout, bool optimize, bool lods, bool meshlets)
+{
+    modelLayout = layout;
+    modelOptimize = optimize;
+    modelLods = lods;
+    modelMeshlets = meshlets;
+}
+
+// Different spellings of the same file, such as "a/../b.obj" and "b.obj",
+// map to the same key so the file is only ever loaded once
+string AssetManager::normalizePath(string filename)
+{
+    filesystem::path path = filesystem::path(SDL_GetBasePath()) / filename;
+
+    error_code error;
+    filesystem::path canonical = filesystem::weakly_canonical(path, error);
+    if(error)
+    {
+        canonical = path.lexically_normal();
+    }
+
+    return canonical.generic_string();
+}
+
+Model* AssetManager::acquireModel(string filename)
+{
+    string key = normalizePath(filename);
+
+    auto existing = models.find(key);
+    if(existing != models.end())
+    {
+        existing->second.references++;
+        return existing->second.model;
+    }
+
+    Model* model = new Model();
+    model->setThreadPool(threadPool);
+    model->setGeometryPool(geometryPool);
+    model->setStagingBuffer(stagingBuffer);
+    model->setVertexLayout(modelLayout);
+    model->setOptimizeEnabled(modelOptimize);
+    model->setLodEnabled(modelLods);
+    model->setMeshletsEnabled(modelMeshlets);
+    model->setFilename(filename);
+
+    ModelEntry entry = {model, 1};
+    models[key] = entry;
+    watchFile(key);
+
+    if(assetLoader != NULL)
+    {
+        assetLoader->loadModel(model);
+    }
+
+    return model;
+}
+
+Texture* AssetManager::acquireTexture(string filename)
+{
+    string key = normalizePath(filename);
+
+    auto existing = textures.find(key);
+    if(existing != textures.end())
+    {
+        existing->second.references++;
+        return existing->second.texture;
+    }
+
+    Texture* texture = new Texture();
+    texture->setStagingBuffer(stagingBuffer);
+    texture->setFilename(filename);
+
+    TextureEntry entry = {texture, 1};
+    textures[key] = entry;
+    watchFile(key);
+
+    if(assetLoader != NULL)
+    {
+        assetLoader->loadTexture(texture);
+    }
+
+    return texture;
+}
+
+Shader* AssetManager::acquireShader(string vertexFilename, string fragmentFilename)
+{
+    string vertexPath = normalizePath(vertexFilename);
+    string fragmentPath = normalizePath(fragmentFilename);
+    string key = vertexPath + "|" + fragmentPath;
+
+    auto existing = shaders.find(key);
+    if(existing != shaders.end())
+    {
+        existing->second.references++;
+        return existing->second.shader;
+    }
+
+    Shader* shader = new Shader();
+    shader->setFilenames(vertexFilename, fragmentFilename);
+
+    ShaderEntry entry = {shader, 1, vertexPath, fragmentPath};
+    shaders[key] = entry;
+    watchFile(vertexPath);
+    watchFile(fragmentPath);
+
+    if(assetLoader != NULL)
+    {
+        assetLoader->loadShader(shader);
+    }
+
+    return shader;
+}
+
+void AssetManager::releaseModel(Model* model)
+{
+    for(auto entry = models.begin(); entry != models.end(); entry++)
+    {
+        if(entry->second.model != model)
+            continue;
+
+        if(--entry->second.references == 0)
+        {
+            models.erase(entry);
+            deferDeletion(model, [model]
+            {
+                model->deleteModel();
+                delete model;
+            });
+        }
+        return;
+    }
+}
+
+void AssetManager::releaseTexture(Texture* texture)
+{
+    for(auto entry = textures.begin(); entry != textures.end(); entry++)
+    {
+        if(entry->second.texture != texture)
+            continue;
+
+        if(--entry->second.references == 0)
+        {
+            textures.erase(entry);
+            deferDeletion(texture, [texture]
+            {
+                texture->deleteTexture();
+                delete texture;
+            });
+        }
+        return;
+    }
+}
+
+void AssetManager::releaseShader(Shader* shader)
+{
+    for(auto entry = shaders.begin(); entry != shaders.end(); entry++)
+    {
+        if(entry->second.shader != shader)
+            continue;
+
+        if(--entry->second.references == 0)
+        {
+            shaders.erase(entry);
+            deferDeletion(shader, [shader]
+            {
+                shader->deleteShader();
+                delete shader;
+            });
+        }
+        return;
+    }
+}
+
+void AssetManager::deferDeletion(const void* asset, function<void()> destroy)
+{
+    DeferredDeletion deletion = {asset, NULL, destroy};
+    deletions.push_back(deletion);
+}
+
+void AssetManager::reloadAll()
+{
+    if(assetLoader == NULL)
+        return;
+
+    for(auto& entry : shaders)
+    {
+        assetLoader->loadShader(entry.second.shader);
+    }
+    for(auto& entry : textures)
+    {
+        assetLoader->loadTexture(entry.second.texture);
+    }
+    for(auto& entry : models)
+    {
+        assetLoader->loadModel(entry.second.model);
+    }
+}
+
+void AssetManager::watchFile(string path)
+{
+    if(fileWatcher != NULL)
+    {
+        fileWatcher->watch(path);
+    }
+}
+
+// Call once per frame. Starts a background load of every asset whose file
+// changed since the last call. The new version replaces the old one when
+// AssetLoader::processCompleted() uploads it, and a load that fails leaves
+// the old version in place. Returns the number of files that changed.
+int AssetManager::reloadChanged()
+{
+    TRACE_ZONE("reloadChanged");
+
+    if(fileWatcher == NULL || assetLoader == NULL)
+        return 0;
+
+    fileWatcher->pollChanges(changedFiles);
+    int changedCount = changedFiles.size();
+
+    // Files saved again while their asset was still loading are retried
+    // next frame, so the final version is never missed
+    changedFiles.insert(changedFiles.end(), retryFiles.begin(), retryFiles.end());
+    retryFiles.clear();
+
+    for(int i = 0; i < (int) changedFiles.size(); i++)
+    {
+        if(!reloadFile(changedFiles[i]))
+        {
+            retryFiles.push_back(changedFiles[i]);
+        }
+    }
+
+    return changedCount;
+}
+
+bool AssetManager::reloadFile(string path)
+{
+    bool started = true;
+
+    auto model = models.find(path);
+    if(model != models.end())
+    {
+        if(assetLoader->isLoading(model->second.model) || !assetLoader->loadModel(model->second.model))
+            started = false;
+    }
+
+    auto texture = textures.find(path);
+    if(texture != textures.end())
+    {
+        if(assetLoader->isLoading(texture->second.texture) || !assetLoader->loadTexture(texture->second.texture))
+            started = false;
+    }
+
+    for(auto& entry : shaders)
+    {
+        if(entry.second.vertexPath != path && entry.second.fragmentPath != path)
+            continue;
+
+        if(assetLoader->isLoading(entry.second.shader) || !assetLoader->loadShader(entry.second.shader))
+            started = false;
+    }
+
+    return started;
+}
+
+// Call once per frame after the frame's draws have been issued. Released
+// assets get a fence at the first call after any background load of theirs
+// has finished, and are destroyed once the GPU has passed that fence.
+void AssetManager::collectGarbage()
+{
+    TRACE_ZONE("collectGarbage");
+
+    for(int i = 0; i < (int) deletions.size(); i++)
+    {
+        DeferredDeletion& deletion = deletions[i];
+
+        if(deletion.fence == NULL)
+        {
+            if(assetLoader == NULL || !assetLoader->isLoading(deletion.asset))
+            {
+                deletion.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            }
+            continue;
+        }
+
+        GLenum result = glClientWaitSync(deletion.fence, 0, 0);
+        if(result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+            continue;
+
+        glDeleteSync(deletion.fence);
+        deletion.destroy();
+
+        deletions.erase(deletions.begin() + i);
+        i--;
+    }
+}
+
+// Frees every asset at shutdown, once background loading has stopped
+void AssetManager::deleteAll()
+{
+    glFinish();
+
+    for(auto& entry : models)
+    {
+        entry.second.model->deleteModel();
+        delete entry.second.model;
+    }
+    for(auto& entry : textures)
+    {
+        entry.second.texture->deleteTexture();
+        delete entry.second.texture;
+    }
+    for(auto& entry : shaders)
+    {
+        entry.second.shader->deleteShader();
+        delete entry.second.shader;
+    }
+
+    models.clear();
+    textures.clear();
+    shaders.clear();
+
+    for(int i = 0; i < (int) deletions.size(); i++)
+    {
+        glDeleteSync(deletions[i].fence);
+        deletions[i].destroy();
+    }
+    deletions.clear();
+}
+
+int AssetManager::getAssetCount()
+{
+    return models.size() + textures.size() + shaders.size();
+}
+
+int AssetManager::getPendingDeletionCount()
+{
+    return deletions.size();
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "assetloader.h"
+#include "filewatcher.h"
+#include "geometrypool.h"
+#include "model.h"
+#include "shader.h"
+#include "stagingbuffer.h"
+#include "texture.h"
+#include "threadpool.h"
+
+#include <GL/glew.h>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+struct ModelEntry
+{
+    Model* model;
+    int references;
+};
+
+struct TextureEntry
+{
+    Texture* texture;
+    int references;
+};
+
+struct ShaderEntry
+{
+    Shader* shader;
+    int references;
+    string vertexPath;
+    string fragmentPath;
+};
+
+struct DeferredDeletion
+{
+    const void* asset;
+    GLsync fence;
+    function<void()> destroy;
+};
+
+class AssetManager
+{
+    public:
+        AssetManager();
+
+        void setAssetLoader(AssetLoader* newAssetLoader);
+        void setThreadPool(ThreadPool* newThreadPool);
+        void setGeometryPool(GeometryPool* newGeometryPool);
+        void setStagingBuffer(StagingBuffer* newStagingBuffer);
+        void setFileWatcher(FileWatcher* newFileWatcher);
+        void setModelDefaults(VertexLayout layout, bool optimize, bool lods, bool meshlets);
+
+        Model* acquireModel(string filename);
+        Texture* acquireTexture(string filename);
+        Shader* acquireShader(string vertexFilename, string fragmentFilename);
+
+        void releaseModel(Model* model);
+        void releaseTexture(Texture* texture);
+        void releaseShader(Shader* shader);
+
+        void reloadAll();
+        int reloadChanged();
+        void collectGarbage();
+        void deleteAll();
+
+        int getAssetCount();
+        int getPendingDeletionCount();
+
+    private:
+        AssetLoader* assetLoader;
+        ThreadPool* threadPool;
+        GeometryPool* geometryPool;
+        StagingBuffer* stagingBuffer;
+        FileWatcher* fileWatcher;
+
+        VertexLayout modelLayout;
+        bool modelOptimize;
+        bool modelLods;
+        bool modelMeshlets;
+
+        unordered_map<string, ModelEntry> models;
+        unordered_map<string, TextureEntry> textures;
+        unordered_map<string, ShaderEntry> shaders;
+
+        vector<DeferredDeletion> deletions;
+        vector<string> changedFiles;
+        vector<string> retryFiles;
+
+        string normalizePath(string filename);
+        void deferDeletion(const void* asset, function<void()> destroy);
+        void watchFile(string path);
+        bool reloadFile(string path);
+};
@@ -0,0 +1,507 @@
+#include "model.h"
+#include "texture.h"
+#include "shader.h"
+#include "threadpool.h"
+#include "loadstatistics.h"
+
+#include <SDL3/SDL.h>
+#include <SDL3/SDL_main.h>
+#include <SDL3_image/SDL_image.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Times the CPU side of loading generated assets. Nothing here needs a
+// window or an OpenGL context, so it runs on headless machines.
+
+struct BenchmarkResult
+{
+    double median;
+    double p90;
+    double p99;
+    double minimum;
+};
+
+string corpusDirectory = "benchmark-corpus";
+int iterations = 10;
+int workerThreads = 0;
+int textureSize = 1024;
+int shaderFunctions = 200;
+vector<int> triangleCounts = {1000, 100000, 1000000};
+
+// Models are processed like the game loads them unless turned off with
+// --optimize, --lod and --meshlets followed by 0 or 1
+bool optimizeModels = false;
+bool modelLods = true;
+bool modelMeshlets = true;
+
+// Every generated file comes from a fixed seed, so runs are comparable
+// between machines and over time
+Uint32 randomState = 1;
+
+Uint32 nextRandom()
+{
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return randomState;
+}
+
+float nextRandomFloat()
+{
+    return (nextRandom() & 0xffffff) / (float) 0xffffff;
+}
+
+// A height field of shared vertices, so each vertex is used by up to six
+// triangles like in a typical mesh
+bool writeOBJ(string filename, int triangles)
+{
+    FILE* file = fopen(filename.c_str(), "wb");
+    if(file == NULL)
+        return false;
+
+    randomState = 1;
+
+    int quads = (triangles + 1) / 2;
+    int columns = max(1, (int) sqrt((double) quads));
+    int rows = (quads + columns - 1) / columns;
+
+    fprintf(file, "# %d triangles\n", triangles);
+    for(int row = 0; row <= rows; row++)
+    {
+        for(int column = 0; column <= columns; column++)
+        {
+            fprintf(file, "v %.6f %.6f %.6f\n", (float) column / columns, nextRandomFloat() * 0.05f, (float) row / rows);
+        }
+    }
+    for(int row = 0; row <= rows; row++)
+    {
+        for(int column = 0; column <= columns; column++)
+        {
+            fprintf(file, "vt %.6f %.6f\n", (float) column / columns, (float) row / rows);
+        }
+    }
+    for(int row = 0; row <= rows; row++)
+    {
+        for(int column = 0; column <= columns; column++)
+        {
+            glm::vec3 normal = glm::normalize(glm::vec3(nextRandomFloat() * 0.2f - 0.1f, 1.0f, nextRandomFloat() * 0.2f - 0.1f));
+            fprintf(file, "vn %.6f %.6f %.6f\n", normal.x, normal.y, normal.z);
+        }
+    }
+
+    int written = 0;
+    for(int quad = 0; quad < quads && written < triangles; quad++)
+    {
+        int row = quad / columns;
+        int column = quad % columns;
+
+        int a = row * (columns + 1) + column + 1;
+        int b = a + 1;
+        int c = a + columns + 1;
+        int d = c + 1;
+
+        fprintf(file, "f %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, c, c, c, b, b, b);
+        written++;
+
+        if(written < triangles)
+        {
+            fprintf(file, "f %d/%d/%d %d/%d/%d %d/%d/%d\n", b, b, b, c, c, c, d, d, d);
+            written++;
+        }
+    }
+
+    return fclose(file) == 0;
+}
+
+// Smooth gradients with noise on top, which compresses about as well as a
+// real diffuse texture
+bool writePNG(string filename, int size)
+{
+    SDL_Surface* surface = SDL_CreateSurface(size, size, SDL_PIXELFORMAT_RGBA32);
+    if(surface == NULL)
+        return false;
+
+    randomState = 2;
+    for(int y = 0; y < size; y++)
+    {
+        Uint8* row = (Uint8*) surface->pixels + (size_t) y * surface->pitch;
+        for(int x = 0; x < size; x++)
+        {
+            int noise = nextRandom() % 32;
+            row[x * 4 + 0] = (Uint8) (x * 223 / size + noise);
+            row[x * 4 + 1] = (Uint8) (y * 223 / size + noise);
+            row[x * 4 + 2] = (Uint8) ((x + y) * 111 / size + noise);
+            row[x * 4 + 3] = 255;
+        }
+    }
+
+    bool saved = IMG_SavePNG(surface, filename.c_str());
+    SDL_DestroySurface(surface);
+
+    return saved;
+}
+
+bool writeShader(string filename, bool isVertexShader, int functions)
+{
+    FILE* file = fopen(filename.c_str(), "wb");
+    if(file == NULL)
+        return false;
+
+    fprintf(file, "#version 460\n\n");
+    if(isVertexShader)
+    {
+        fprintf(file, "layout(location = 0) in vec3 vertexPosition;\nlayout(location = 0) uniform mat4 pvmMatrix;\n\n");
+    }
+    else
+    {
+        fprintf(file, "out vec4 fragment;\n\n");
+    }
+
+    for(int i = 0; i < functions; i++)
+    {
+        fprintf(file, "vec4 function%d(vec4 value)\n{\n    return value * %d.0 + vec4(%d.0, 0.5, 0.25, 1.0);\n}\n\n", i, i % 7 + 1, i);
+    }
+
+    fprintf(file, "void main()\n{\n    vec4 value = vec4(1.0);\n");
+    for(int i = 0; i < functions; i++)
+    {
+        fprintf(file, "    value = function%d(value);\n", i);
+    }
+
+    if(isVertexShader)
+    {
+        fprintf(file, "    gl_Position = pvmMatrix * vec4(vertexPosition, 1.0) + value * 0.0;\n}\n");
+    }
+    else
+    {
+        fprintf(file, "    fragment = value;\n}\n");
+    }
+
+    return fclose(file) == 0;
+}
+
+// Nearest-rank percentile of sorted samples
+double getPercentile(vector<double>& sorted, double percentile)
+{
+    int rank = (int) ceil(percentile * sorted.size()) - 1;
+    return sorted[max(0, min(rank, (int) sorted.size() - 1))];
+}
+
+// Runs the load once untimed to warm the file cache, then the requested
+// number of times. The load fills in its record so the phases of the
+// median run can be shown.
+bool runBenchmark(string name, size_t bytes, function<bool(LoadRecord&)> load, BenchmarkResult& result)
+{
+    LoadRecord record;
+    if(!load(record))
+    {
+        printf("%-36s failed\n", name.c_str());
+        return false;
+    }
+
+    vector<double> seconds;
+    vector<LoadRecord> records;
+    for(int i = 0; i < iterations; i++)
+    {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        bool loaded = load(record);
+        seconds.push_back(chrono::duration<double>(chrono::steady_clock::now() - start).count());
+        records.push_back(record);
+
+        if(!loaded)
+        {
+            printf("%-36s failed\n", name.c_str());
+            return false;
+        }
+    }
+
+    vector<double> sorted = seconds;
+    sort(sorted.begin(), sorted.end());
+
+    result.median = getPercentile(sorted, 0.5);
+    result.p90 = getPercentile(sorted, 0.9);
+    result.p99 = getPercentile(sorted, 0.99);
+    result.minimum = sorted[0];
+
+    double megabytesPerSecond = bytes / (1024.0 * 1024.0) / result.median;
+    printf("%-36s %9.3f %9.3f %9.3f %9.3f %10.1f\n", name.c_str(), result.minimum * 1000.0, result.median * 1000.0,
+           result.p90 * 1000.0, result.p99 * 1000.0, megabytesPerSecond);
+
+    LoadRecord& medianRecord = records[find(seconds.begin(), seconds.end(), result.median) - seconds.begin()];
+    printf("%-36s", "");
+    for(int phase = 0; phase < LOAD_PHASE_COUNT; phase++)
+    {
+        if(medianRecord.phaseSeconds[phase] > 0.0)
+        {
+            printf(" %s %.3f", LoadStatistics::getPhaseName((LoadPhase) phase), medianRecord.phaseSeconds[phase] * 1000.0);
+        }
+    }
+    printf(", %zu allocations\n", medianRecord.allocations);
+
+    LoadStatistics::clear();
+    return true;
+}
+
+size_t getFileSize(string filename)
+{
+    error_code error;
+    uintmax_t size = filesystem::file_size(filename, error);
+    return error ? 0 : size;
+}
+
+// Powers of two up to the --threads limit, which defaults to every
+// hardware thread, ending on the limit itself
+vector<int> getThreadCounts()
+{
+    int maximum = workerThreads > 0 ? workerThreads : max(1, (int) thread::hardware_concurrency());
+
+    vector<int> counts;
+    for(int count = 1; count < maximum; count *= 2)
+    {
+        counts.push_back(count);
+    }
+    counts.push_back(maximum);
+    return counts;
+}
+
+void benchmarkModels(string basePath)
+{
+    vector<int> threadCounts = getThreadCounts();
+
+    for(int triangles : triangleCounts)
+    {
+        string relativeName = corpusDirectory + "/grid_" + to_string(triangles) + ".obj";
+        string filename = basePath + relativeName;
+
+        if(getFileSize(filename) == 0 && !writeOBJ(filename, triangles))
+        {
+            printf("Unable to write %s\n", filename.c_str());
+            continue;
+        }
+        size_t bytes = getFileSize(filename);
+
+        auto loadModel = [&](ThreadPool* threadPool, bool cached)
+        {
+            return [&, threadPool, cached](LoadRecord& record)
+            {
+                Model model;
+                model.setThreadPool(threadPool);
+                model.setCacheEnabled(cached);
+                model.setOptimizeEnabled(optimizeModels);
+                model.setLodEnabled(modelLods);
+                model.setMeshletsEnabled(modelMeshlets);
+                model.setFilename(relativeName);
+
+                bool prepared = model.prepareOBJModel();
+                record = model.getLoadRecord();
+                if(!prepared)
+                {
+                    printf("%s\n", model.getError().c_str());
+                }
+                return prepared;
+            };
+        };
+
+        string label = "model " + to_string(triangles) + " triangles";
+
+        // The pool is restarted with each count, so the speedups show how
+        // loading scales from one worker to all of them
+        ThreadPool pool;
+        BenchmarkResult single = BenchmarkResult();
+        bool singleDone = false;
+        for(int threads : threadCounts)
+        {
+            pool.start(threads);
+
+            BenchmarkResult result;
+            bool done = runBenchmark(label + ", " + to_string(threads) + (threads == 1 ? " thread" : " threads"), bytes, loadModel(&pool, false), result);
+            if(threads == 1)
+            {
+                single = result;
+                singleDone = done;
+            }
+
+            if(done && singleDone)
+            {
+                printf("%-36s %.2fx speedup over 1 thread, %.0f triangles per ms\n", "", single.median / result.median, triangles / (result.median * 1000.0));
+            }
+        }
+
+        // Throughput of cached loads is measured against the cache file,
+        // using the pool with the most threads
+        BenchmarkResult cached;
+        LoadRecord record;
+        loadModel(&pool, true)(record);
+        runBenchmark(label + ", cached", getFileSize(filename + ".meshcache"), loadModel(&pool, true), cached);
+
+        pool.stop();
+    }
+}
+
+void benchmarkTexture(string basePath)
+{
+    string relativeName = corpusDirectory + "/noise_" + to_string(textureSize) + ".png";
+    string filename = basePath + relativeName;
+
+    if(getFileSize(filename) == 0 && !writePNG(filename, textureSize))
+    {
+        printf("Unable to write %s: %s\n", filename.c_str(), SDL_GetError());
+        return;
+    }
+
+    auto loadTexture = [&](LoadRecord& record)
+    {
+        Texture texture;
+        texture.setFilename(relativeName);
+
+        bool prepared = texture.prepareTexture();
+        record = texture.getLoadRecord();
+        if(!prepared)
+        {
+            printf("%s\n", texture.getError().c_str());
+        }
+        return prepared;
+    };
+
+    BenchmarkResult result;
+    runBenchmark("texture " + to_string(textureSize) + "x" + to_string(textureSize), getFileSize(filename), loadTexture, result);
+}
+
+void benchmarkShader(string basePath)
+{
+    string vertexName = corpusDirectory + "/generated_vertex_" + to_string(shaderFunctions) + ".glsl";
+    string fragmentName = corpusDirectory + "/generated_fragment_" + to_string(shaderFunctions) + ".glsl";
+    string vertexFilename = basePath + vertexName;
+    string fragmentFilename = basePath + fragmentName;
+
+    if(!writeShader(vertexFilename, true, shaderFunctions) || !writeShader(fragmentFilename, false, shaderFunctions))
+    {
+        printf("Unable to write shaders to %s\n", corpusDirectory.c_str());
+        return;
+    }
+
+    // Compiling needs a context, so only reading the sources is timed here
+    auto loadShader = [&](LoadRecord& record)
+    {
+        Shader shader;
+        shader.setFilenames(vertexName, fragmentName);
+
+        bool prepared = shader.prepareShader();
+        record = shader.getLoadRecord();
+        if(!prepared)
+        {
+            printf("%s\n", shader.getError().c_str());
+        }
+        return prepared;
+    };
+
+    BenchmarkResult result;
+    runBenchmark("shader " + to_string(shaderFunctions) + " functions", getFileSize(vertexFilename) + getFileSize(fragmentFilename), loadShader, result);
+}
+
+vector<int> parseList(string text)
+{
+    vector<int> values;
+    size_t start = 0;
+    while(start < text.size())
+    {
+        size_t end = text.find(',', start);
+        if(end == string::npos)
+        {
+            end = text.size();
+        }
+
+        int value = atoi(text.substr(start, end - start).c_str());
+        if(value > 0)
+        {
+            values.push_back(value);
+        }
+        start = end + 1;
+    }
+    return values;
+}
+
+int main(int argc, char* argv[])
+{
+    for(int i = 1; i < argc; i++)
+    {
+        string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if(argument == "--corpus" && hasValue)
+        {
+            corpusDirectory = argv[++i];
+        }
+        else if(argument == "--iterations" && hasValue)
+        {
+            iterations = max(1, atoi(argv[++i]));
+        }
+        else if(argument == "--threads" && hasValue)
+        {
+            workerThreads = max(0, atoi(argv[++i]));
+        }
+        else if(argument == "--triangles" && hasValue)
+        {
+            triangleCounts = parseList(argv[++i]);
+        }
+        else if(argument == "--optimize" && hasValue)
+        {
+            optimizeModels = atoi(argv[++i]) != 0;
+        }
+        else if(argument == "--lod" && hasValue)
+        {
+            modelLods = atoi(argv[++i]) != 0;
+        }
+        else if(argument == "--meshlets" && hasValue)
+        {
+            modelMeshlets = atoi(argv[++i]) != 0;
+        }
+        else if(argument == "--texture-size" && hasValue)
+        {
+            textureSize = max(1, atoi(argv[++i]));
+        }
+        else if(argument == "--shader-functions" && hasValue)
+        {
+            shaderFunctions = max(0, atoi(argv[++i]));
+        }
+        else
+        {
+            printf("Usage: %s [--corpus dir] [--iterations n] [--threads n] [--triangles n,n,...] [--optimize 0|1] [--lod 0|1] [--meshlets 0|1] [--texture-size n] [--shader-functions n]\n", argv[0]);
+            return argument == "--help" ? 0 : -1;
+        }
+    }
+
+    // The assets resolve their own paths against the base path as well
+    const char* basePath = SDL_GetBasePath();
+    if(basePath == NULL)
+    {
+        printf("Unable to get the base path: %s\n", SDL_GetError());
+        return -1;
+    }
+
+    error_code error;
+    filesystem::create_directories(basePath + corpusDirectory, error);
+    if(error)
+    {
+        printf("Unable to create corpus directory %s: %s\n", corpusDirectory.c_str(), error.message().c_str());
+        return -1;
+    }
+
+    printf("%d iterations, times in ms\n", iterations);
+    printf("%-36s %9s %9s %9s %9s %10s\n", "benchmark", "min", "median", "p90", "p99", "MB/s");
+
+    benchmarkModels(basePath);
+    benchmarkTexture(basePath);
+    benchmarkShader(basePath);
+
+    return 0;
+}
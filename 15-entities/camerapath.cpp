@@ -0,0 +1,117 @@
+#include "camerapath.h"
+
+#include <SDL3/SDL.h>
+#include <stdio.h>
+
+CameraPath::CameraPath()
+{
+}
+
+// Each line holds "time x y z pitch yaw", with times in seconds and angles
+// in degrees as used by the camera in main.cpp. Lines starting with # are
+// ignored. Angles are interpolated as written, so a path turning through
+// 360 degrees should keep counting past it rather than wrapping.
+bool CameraPath::loadPath(string newFilename)
+{
+    filename = SDL_GetBasePath() + newFilename;
+    keyframes.clear();
+    errorMessage = "";
+
+    FILE* file = fopen(filename.c_str(), "r");
+    if(file == NULL)
+    {
+        errorMessage = "Unable to open camera path: " + filename;
+        return false;
+    }
+
+    char line[256];
+    int lineNumber = 0;
+    while(fgets(line, sizeof(line), file) != NULL)
+    {
+        lineNumber++;
+
+        char first = '\0';
+        if(sscanf(line, " %c", &first) != 1 || first == '#')
+            continue;
+
+        CameraKeyframe keyframe;
+        int values = sscanf(line, "%f %f %f %f %f %f", &keyframe.time, &keyframe.x, &keyframe.y, &keyframe.z, &keyframe.pitch, &keyframe.yaw);
+        if(values != 6 || (!keyframes.empty() && keyframe.time <= keyframes.back().time))
+        {
+            errorMessage = "Invalid camera keyframe on line " + to_string(lineNumber) + ": " + filename;
+            fclose(file);
+            keyframes.clear();
+            return false;
+        }
+
+        keyframes.push_back(keyframe);
+    }
+    fclose(file);
+
+    if(keyframes.empty())
+    {
+        errorMessage = "Camera path has no keyframes: " + filename;
+        return false;
+    }
+
+    return true;
+}
+
+CameraKeyframe CameraPath::sample(float time)
+{
+    if(time <= keyframes.front().time)
+        return keyframes.front();
+    if(time >= keyframes.back().time)
+        return keyframes.back();
+
+    int next = 1;
+    while(keyframes[next].time < time)
+    {
+        next++;
+    }
+
+    CameraKeyframe& a = keyframes[next - 1];
+    CameraKeyframe& b = keyframes[next];
+    float t = (time - a.time) / (b.time - a.time);
+
+    CameraKeyframe result;
+    result.time = time;
+    result.x = a.x + (b.x - a.x) * t;
+    result.y = a.y + (b.y - a.y) * t;
+    result.z = a.z + (b.z - a.z) * t;
+    result.pitch = a.pitch + (b.pitch - a.pitch) * t;
+    result.yaw = a.yaw + (b.yaw - a.yaw) * t;
+
+    return result;
+}
+
+float CameraPath::getStartTime()
+{
+    if(keyframes.empty())
+        return 0.0f;
+
+    return keyframes.front().time;
+}
+
+float CameraPath::getDuration()
+{
+    if(keyframes.empty())
+        return 0.0f;
+
+    return keyframes.back().time - keyframes.front().time;
+}
+
+bool CameraPath::isLoaded()
+{
+    return !keyframes.empty();
+}
+
+string CameraPath::getFilename()
+{
+    return filename;
+}
+
+string CameraPath::getError()
+{
+    return errorMessage;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+struct CameraKeyframe
+{
+    float time;
+    float x, y, z;
+    float pitch, yaw;
+};
+
+class CameraPath
+{
+    public:
+        CameraPath();
+
+        bool loadPath(string newFilename);
+
+        CameraKeyframe sample(float time);
+        float getStartTime();
+        float getDuration();
+        bool isLoaded();
+
+        string getFilename();
+        string getError();
+
+    private:
+        string filename;
+        vector<CameraKeyframe> keyframes;
+        string errorMessage;
+};
@@ -1,5 +1,10 @@
 #include "entity.h"
 
+float Entity::lodThreshold = 1.0f;
+long Entity::trianglesDrawn = 0;
+long Entity::trianglesSaved = 0;
+long Entity::trianglesCulled = 0;
+
 Entity::Entity()
 {
     model = NULL;
@@ -11,6 +16,7 @@ Entity::Entity()
     rx = 0;
     ry = 0;
     rz = 0;
+    currentLod = 0;
 
     updateModelMatrix();
 }
@@ -20,11 +26,48 @@ void Entity::setModel(Model* newModel)
     model = newModel;
 }
 
+void Entity::setLodThreshold(float pixels)
+{
+    lodThreshold = pixels;
+}
+
+void Entity::resetStatistics()
+{
+    trianglesDrawn = 0;
+    trianglesSaved = 0;
+    trianglesCulled = 0;
+}
+
+long Entity::getTrianglesDrawn()
+{
+    return trianglesDrawn;
+}
+
+long Entity::getTrianglesSaved()
+{
+    return trianglesSaved;
+}
+
+long Entity::getTrianglesCulled()
+{
+    return trianglesCulled;
+}
+
 void Entity::setTexture(Texture* newTexture)
 {
     texture = newTexture;
 }
 
+Model* Entity::getModel()
+{
+    return model;
+}
+
+Texture* Entity::getTexture()
+{
+    return texture;
+}
+
 void Entity::setPosition(float newX, float newY, float newZ)
 {
     x = newX;
@@ -59,19 +102,137 @@ void Entity::updateModelMatrix()
     modelMatrix = t * r;
 }
 
-void Entity::draw()
+void Entity::selectLod(glm::vec3 cameraPosition, float screenScale)
 {
-    if(model == NULL || texture == NULL)
-        return;
+    int lodCount = model->getLodCount();
+    if(currentLod >= lodCount)
+        currentLod = lodCount - 1;
+
+    // Project each level's simplification error onto the screen, measuring
+    // from the nearest point of the bounding sphere
+    float radius = model->getBoundingRadius();
+    glm::vec3 center = glm::vec3(modelMatrix * glm::vec4(model->getBoundingCenter(), 1.0f));
+    float distance = glm::length(center - cameraPosition) - radius;
+    if(distance < 0.001f)
+        distance = 0.001f;
+
+    float worldScale = 2.0f * radius * screenScale / distance;
+
+    // Only step to a coarser level once it is comfortably under the
+    // threshold, so that entities near the boundary do not flicker
+    while(currentLod > 0 && model->getLodError(currentLod) * worldScale > lodThreshold)
+    {
+        currentLod--;
+    }
+    while(currentLod + 1 < lodCount && model->getLodError(currentLod + 1) * worldScale < lodThreshold * 0.75f)
+    {
+        currentLod++;
+    }
+}
 
-    glActiveTexture(GL_TEXTURE0);
-    texture->bind();
+// Adds a draw command for each run of visible meshlets, drawing a single
+// instance whose model matrix is at baseInstance
+void Entity::addMeshletCommands(glm::mat4 pvMatrix, glm::vec3 cameraPosition, GLuint baseInstance, vector<DrawElementsIndirectCommand>& commands)
+{
+    // Cull in model space, using frustum planes taken from the rows of the
+    // combined matrix and the camera moved into the model's frame
+    glm::mat4 m = pvMatrix * modelMatrix;
+    glm::vec4 planes[6];
+    for(int i = 0; i < 3; i++)
+    {
+        glm::vec4 row = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+        glm::vec4 w = glm::vec4(m[0][3], m[1][3], m[2][3], m[3][3]);
+        planes[i * 2] = w + row;
+        planes[i * 2 + 1] = w - row;
+    }
+    for(int i = 0; i < 6; i++)
+    {
+        planes[i] = planes[i] / glm::length(glm::vec3(planes[i]));
+    }
+
+    glm::vec3 camera = glm::vec3(glm::inverse(modelMatrix) * glm::vec4(cameraPosition, 1.0f));
+    int indexSize = model->getIndexSize();
+    int firstCommand = commands.size();
+
+    for(int i = 0; i < model->getMeshletCount(); i++)
+    {
+        const Meshlet& meshlet = model->getMeshlet(i);
+
+        bool visible = true;
+        for(int plane = 0; plane < 6 && visible; plane++)
+        {
+            visible = glm::dot(glm::vec3(planes[plane]), meshlet.center) + planes[plane].w > -meshlet.radius;
+        }
+
+        // Back-facing if the camera lies inside the cone of directions from
+        // which every triangle in the cluster faces away
+        glm::vec3 toCenter = meshlet.center - camera;
+        if(visible && glm::dot(toCenter, meshlet.coneAxis) >= meshlet.coneCutoff * glm::length(toCenter) + meshlet.radius)
+        {
+            visible = false;
+        }
+
+        if(!visible)
+        {
+            trianglesCulled += meshlet.indexCount / 3;
+            continue;
+        }
+
+        // Neighbouring visible meshlets are contiguous in the index buffer,
+        // so they merge into a single range
+        GLuint firstIndex = (uintptr_t) model->getIndexOffset(meshlet.firstIndex) / indexSize;
+        if((int) commands.size() > firstCommand && commands.back().firstIndex + commands.back().count == firstIndex)
+        {
+            commands.back().count += meshlet.indexCount;
+        }
+        else
+        {
+            DrawElementsIndirectCommand command = {meshlet.indexCount, 1, firstIndex, model->getBaseVertex(), baseInstance};
+            commands.push_back(command);
+        }
+        trianglesDrawn += meshlet.indexCount / 3;
+    }
+}
 
-    model->bind();
+glm::mat4 Entity::getModelMatrix()
+{
+    return modelMatrix;
+}
+
+int Entity::getLod()
+{
+    return currentLod;
+}
 
-    glUniformMatrix4fv(2, 1, GL_FALSE, glm::value_ptr(modelMatrix));
-    glDrawElements(GL_TRIANGLES, model->getIndexCount(), GL_UNSIGNED_INT, 0);
+// Returns false for entities still loading in the background or whose
+// bounding sphere lies outside the frustum, and otherwise picks the level
+// of detail to draw
+bool Entity::prepareDraw(const glm::vec4 frustumPlanes[6], glm::vec3 cameraPosition, float screenScale)
+{
+    if(model == NULL || texture == NULL)
+        return false;
+
+    if(!model->isLoaded() || !texture->isLoaded())
+        return false;
+
+    glm::vec3 center = glm::vec3(modelMatrix * glm::vec4(model->getBoundingCenter(), 1.0f));
+    float radius = model->getBoundingRadius();
+    for(int plane = 0; plane < 6; plane++)
+    {
+        if(glm::dot(glm::vec3(frustumPlanes[plane]), center) + frustumPlanes[plane].w < -radius)
+        {
+            trianglesCulled += model->getIndexCount() / 3;
+            return false;
+        }
+    }
+
+    selectLod(cameraPosition, screenScale);
+    return true;
+}
 
-    model->unbind();
-    texture->unbind();
+void Entity::countDrawnTriangles()
+{
+    GLsizei indexCount = model->getLodIndexCount(currentLod);
+    trianglesDrawn += indexCount / 3;
+    trianglesSaved += (model->getIndexCount() - indexCount) / 3;
 }
@@ -7,6 +7,9 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/ext/matrix_transform.hpp>
+#include <vector>
+
+using namespace std;
 
 class Entity
 {
@@ -15,11 +18,24 @@ class Entity
 
         void setModel(Model* newModel);
         void setTexture(Texture* newTexture);
+        Model* getModel();
+        Texture* getTexture();
 
         void setPosition(float newX, float newY, float newZ);
         void setOrientation(float newRX, float newRY, float newRZ);
 
-        void draw();
+        glm::mat4 getModelMatrix();
+        int getLod();
+
+        bool prepareDraw(const glm::vec4 frustumPlanes[6], glm::vec3 cameraPosition, float screenScale);
+        void addMeshletCommands(glm::mat4 pvMatrix, glm::vec3 cameraPosition, GLuint baseInstance, vector<DrawElementsIndirectCommand>& commands);
+        void countDrawnTriangles();
+
+        static void setLodThreshold(float pixels);
+        static void resetStatistics();
+        static long getTrianglesDrawn();
+        static long getTrianglesSaved();
+        static long getTrianglesCulled();
 
     private:
         Model* model;
@@ -28,6 +44,14 @@ class Entity
         float x, y, z;
         float rx, ry, rz;
 
+        int currentLod;
+
+        static float lodThreshold;
+        static long trianglesDrawn;
+        static long trianglesSaved;
+        static long trianglesCulled;
+
         glm::mat4 modelMatrix;
         void updateModelMatrix();
+        void selectLod(glm::vec3 cameraPosition, float screenScale);
 };
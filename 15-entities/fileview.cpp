@@ -0,0 +1,189 @@
+#include "fileview.h"
+
+#include <fstream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+FileView::FileView()
+{
+    data = NULL;
+    size = 0;
+    mapped = false;
+
+    fileHandle = NULL;
+    mappingHandle = NULL;
+}
+
+FileView::~FileView()
+{
+    close();
+}
+
+bool FileView::open(string filename)
+{
+    close();
+
+    if(mapFile(filename))
+    {
+        return true;
+    }
+
+    // Mapping can fail on some filesystems and for empty files, so fall
+    // back to reading the whole file into memory
+    return readFile(filename);
+}
+
+#ifdef _WIN32
+
+bool FileView::mapFile(string filename)
+{
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if(file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if(!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if(mapping == NULL)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if(view == NULL)
+    {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    fileHandle = file;
+    mappingHandle = mapping;
+    data = (const char*) view;
+    size = (size_t) fileSize.QuadPart;
+    mapped = true;
+
+    return true;
+}
+
+#else
+
+bool FileView::mapFile(string filename)
+{
+    int file = ::open(filename.c_str(), O_RDONLY);
+    if(file < 0)
+    {
+        return false;
+    }
+
+    struct stat fileStatus;
+    if(fstat(file, &fileStatus) != 0 || fileStatus.st_size == 0)
+    {
+        ::close(file);
+        return false;
+    }
+
+    void* view = mmap(NULL, fileStatus.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    ::close(file);
+    if(view == MAP_FAILED)
+    {
+        return false;
+    }
+
+    madvise(view, fileStatus.st_size, MADV_SEQUENTIAL);
+
+    data = (const char*) view;
+    size = fileStatus.st_size;
+    mapped = true;
+
+    return true;
+}
+
+#endif
+
+bool FileView::readFile(string filename)
+{
+    ifstream fileStream(filename, ios::binary | ios::ate);
+    if(!fileStream)
+    {
+        errorMessage = "Cannot open file: ";
+        errorMessage += filename;
+        return false;
+    }
+
+    buffer.resize(fileStream.tellg());
+    fileStream.seekg(0);
+    if(!fileStream.read(buffer.data(), buffer.size()))
+    {
+        buffer.clear();
+        errorMessage = "Cannot read file: ";
+        errorMessage += filename;
+        return false;
+    }
+
+    data = buffer.data();
+    size = buffer.size();
+
+    return true;
+}
+
+void FileView::close()
+{
+    if(mapped)
+    {
+#ifdef _WIN32
+        UnmapViewOfFile(data);
+        CloseHandle((HANDLE) mappingHandle);
+        CloseHandle((HANDLE) fileHandle);
+#else
+        munmap((void*) data, size);
+#endif
+    }
+
+    buffer.clear();
+    buffer.shrink_to_fit();
+
+    data = NULL;
+    size = 0;
+    mapped = false;
+
+    fileHandle = NULL;
+    mappingHandle = NULL;
+
+    errorMessage = "";
+}
+
+const char* FileView::getData()
+{
+    return data;
+}
+
+size_t FileView::getSize()
+{
+    return size;
+}
+
+bool FileView::isMapped()
+{
+    return mapped;
+}
+
+string FileView::getError()
+{
+    return errorMessage;
+}
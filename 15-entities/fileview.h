@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+class FileView
+{
+    public:
+        FileView();
+        ~FileView();
+
+        FileView(const FileView&) = delete;
+        FileView& operator=(const FileView&) = delete;
+
+        bool open(string filename);
+        void close();
+
+        const char* getData();
+        size_t getSize();
+        bool isMapped();
+
+        string getError();
+
+    private:
+        const char* data;
+        size_t size;
+        bool mapped;
+
+        vector<char> buffer;
+        string errorMessage;
+
+        void* fileHandle;
+        void* mappingHandle;
+
+        bool mapFile(string filename);
+        bool readFile(string filename);
+};
@@ -0,0 +1,182 @@
+#include "filewatcher.h"
+
+#include <algorithm>
+
+#ifdef __linux__
+#include <errno.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+FileWatcher::FileWatcher()
+{
+    notifyHandle = -1;
+    pollInterval = chrono::milliseconds(500);
+}
+
+FileWatcher::~FileWatcher()
+{
+    stop();
+}
+
+// Uses inotify where it is available, and otherwise falls back to checking
+// modification times every poll interval
+bool FileWatcher::start()
+{
+    stop();
+
+#ifdef __linux__
+    notifyHandle = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(notifyHandle < 0)
+    {
+        errorMessage = "Unable to initialise inotify, polling for changes instead";
+        return false;
+    }
+
+    for(auto& file : watchedFiles)
+    {
+        if(!watchDirectory(filesystem::path(file.first).parent_path().generic_string()))
+            return false;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+void FileWatcher::stop()
+{
+#ifdef __linux__
+    if(notifyHandle >= 0)
+    {
+        close(notifyHandle);
+    }
+#endif
+    notifyHandle = -1;
+    watchedDirectories.clear();
+}
+
+void FileWatcher::watch(string filename)
+{
+    if(watchedFiles.count(filename) > 0)
+        return;
+
+    error_code error;
+    watchedFiles[filename] = filesystem::last_write_time(filename, error);
+
+    if(notifyHandle >= 0)
+    {
+        watchDirectory(filesystem::path(filename).parent_path().generic_string());
+    }
+}
+
+void FileWatcher::setPollInterval(int milliseconds)
+{
+    pollInterval = chrono::milliseconds(milliseconds);
+}
+
+// Watching directories rather than files catches editors that save by
+// writing a new file and renaming it over the old one
+bool FileWatcher::watchDirectory(string directory)
+{
+#ifdef __linux__
+    for(auto& watched : watchedDirectories)
+    {
+        if(watched.second == directory)
+            return true;
+    }
+
+    int watchHandle = inotify_add_watch(notifyHandle, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if(watchHandle < 0)
+    {
+        errorMessage = "Unable to watch directory, polling for changes instead: " + directory;
+        stop();
+        return false;
+    }
+
+    watchedDirectories[watchHandle] = directory;
+    return true;
+#else
+    return false;
+#endif
+}
+
+// Fills changedFiles with each watched file written since the last call,
+// once per file. Returns true if anything changed.
+bool FileWatcher::pollChanges(vector<string>& changedFiles)
+{
+    changedFiles.clear();
+
+    if(notifyHandle >= 0)
+    {
+        readNotifications(changedFiles);
+    }
+    else
+    {
+        pollModifiedTimes(changedFiles);
+    }
+
+    sort(changedFiles.begin(), changedFiles.end());
+    changedFiles.erase(unique(changedFiles.begin(), changedFiles.end()), changedFiles.end());
+
+    return !changedFiles.empty();
+}
+
+void FileWatcher::readNotifications(vector<string>& changedFiles)
+{
+#ifdef __linux__
+    alignas(inotify_event) char buffer[4096];
+
+    while(true)
+    {
+        ssize_t length = read(notifyHandle, buffer, sizeof(buffer));
+        if(length <= 0)
+            break;
+
+        for(ssize_t offset = 0; offset < length;)
+        {
+            inotify_event* event = (inotify_event*) (buffer + offset);
+            offset += sizeof(inotify_event) + event->len;
+
+            auto directory = watchedDirectories.find(event->wd);
+            if(directory == watchedDirectories.end() || event->len == 0)
+                continue;
+
+            string filename = directory->second + "/" + event->name;
+            if(watchedFiles.count(filename) > 0)
+            {
+                changedFiles.push_back(filename);
+            }
+        }
+    }
+#endif
+}
+
+void FileWatcher::pollModifiedTimes(vector<string>& changedFiles)
+{
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+    if(now - lastPoll < pollInterval)
+        return;
+    lastPoll = now;
+
+    for(auto& file : watchedFiles)
+    {
+        error_code error;
+        filesystem::file_time_type modified = filesystem::last_write_time(file.first, error);
+        if(!error && modified != file.second)
+        {
+            file.second = modified;
+            changedFiles.push_back(file.first);
+        }
+    }
+}
+
+bool FileWatcher::isUsingNotifications()
+{
+    return notifyHandle >= 0;
+}
+
+string FileWatcher::getError()
+{
+    return errorMessage;
+}
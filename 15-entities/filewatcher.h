@@ -0,0 +1,40 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+class FileWatcher
+{
+    public:
+        FileWatcher();
+        ~FileWatcher();
+
+        bool start();
+        void stop();
+
+        void watch(string filename);
+        void setPollInterval(int milliseconds);
+        bool pollChanges(vector<string>& changedFiles);
+
+        bool isUsingNotifications();
+        string getError();
+
+    private:
+        int notifyHandle;
+        map<int, string> watchedDirectories;
+        map<string, filesystem::file_time_type> watchedFiles;
+
+        chrono::milliseconds pollInterval;
+        chrono::steady_clock::time_point lastPoll;
+
+        string errorMessage;
+
+        bool watchDirectory(string directory);
+        void readNotifications(vector<string>& changedFiles);
+        void pollModifiedTimes(vector<string>& changedFiles);
+};
@@ -0,0 +1,124 @@
+#include "framebuffer.h"
+
+#include <SDL3/SDL.h>
+#include <SDL3_image/SDL_image.h>
+#include <string.h>
+#include <vector>
+
+Framebuffer::Framebuffer()
+{
+    framebufferHandle = 0;
+    colorBuffer = 0;
+    depthBuffer = 0;
+    width = 0;
+    height = 0;
+}
+
+bool Framebuffer::create(int newWidth, int newHeight)
+{
+    deleteFramebuffer();
+
+    width = newWidth;
+    height = newHeight;
+
+    glCreateRenderbuffers(1, &colorBuffer);
+    glNamedRenderbufferStorage(colorBuffer, GL_RGBA8, width, height);
+
+    glCreateRenderbuffers(1, &depthBuffer);
+    glNamedRenderbufferStorage(depthBuffer, GL_DEPTH_COMPONENT24, width, height);
+
+    glCreateFramebuffers(1, &framebufferHandle);
+    glNamedFramebufferRenderbuffer(framebufferHandle, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+    glNamedFramebufferRenderbuffer(framebufferHandle, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+
+    if(glCheckNamedFramebufferStatus(framebufferHandle, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        errorMessage = "Framebuffer is incomplete";
+        deleteFramebuffer();
+        return false;
+    }
+
+    return true;
+}
+
+void Framebuffer::deleteFramebuffer()
+{
+    if(framebufferHandle == 0 && colorBuffer == 0 && depthBuffer == 0)
+        return;
+
+    glDeleteFramebuffers(1, &framebufferHandle);
+    glDeleteRenderbuffers(1, &colorBuffer);
+    glDeleteRenderbuffers(1, &depthBuffer);
+
+    framebufferHandle = 0;
+    colorBuffer = 0;
+    depthBuffer = 0;
+}
+
+void Framebuffer::bind()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, framebufferHandle);
+    glViewport(0, 0, width, height);
+}
+
+void Framebuffer::unbind()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+// Reads back the colour buffer and writes it as a PNG, top row first
+bool Framebuffer::saveScreenshot(string filename)
+{
+    vector<unsigned char> pixels((size_t) width * height * 4);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebufferHandle);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+    size_t rowSize = (size_t) width * 4;
+    vector<unsigned char> row(rowSize);
+    for(int y = 0; y < height / 2; y++)
+    {
+        unsigned char* top = pixels.data() + y * rowSize;
+        unsigned char* bottom = pixels.data() + (height - 1 - y) * rowSize;
+        memcpy(row.data(), top, rowSize);
+        memcpy(top, bottom, rowSize);
+        memcpy(bottom, row.data(), rowSize);
+    }
+
+    SDL_Surface* surface = SDL_CreateSurfaceFrom(width, height, SDL_PIXELFORMAT_RGBA32, pixels.data(), rowSize);
+    if(surface == NULL)
+    {
+        errorMessage = "Unable to create screenshot surface: ";
+        errorMessage += SDL_GetError();
+        return false;
+    }
+
+    bool saved = IMG_SavePNG(surface, filename.c_str());
+    SDL_DestroySurface(surface);
+
+    if(!saved)
+    {
+        errorMessage = "Unable to save screenshot: ";
+        errorMessage += SDL_GetError();
+        return false;
+    }
+
+    return true;
+}
+
+int Framebuffer::getWidth()
+{
+    return width;
+}
+
+int Framebuffer::getHeight()
+{
+    return height;
+}
+
+string Framebuffer::getError()
+{
+    return errorMessage;
+}
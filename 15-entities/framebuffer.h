@@ -0,0 +1,31 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <string>
+
+using namespace std;
+
+class Framebuffer
+{
+    public:
+        Framebuffer();
+
+        bool create(int newWidth, int newHeight);
+        void deleteFramebuffer();
+
+        void bind();
+        void unbind();
+        bool saveScreenshot(string filename);
+
+        int getWidth();
+        int getHeight();
+        string getError();
+
+    private:
+        GLuint framebufferHandle;
+        GLuint colorBuffer;
+        GLuint depthBuffer;
+        int width, height;
+
+        string errorMessage;
+};
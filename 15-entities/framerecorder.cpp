@@ -0,0 +1,180 @@
+#include "framerecorder.h"
+#include "jsonwriter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdio.h>
+
+FrameRecorder::FrameRecorder()
+{
+    queriesCreated = false;
+    collectedFrames = 0;
+}
+
+void FrameRecorder::create()
+{
+    deleteQueries();
+
+    glCreateQueries(GL_TIMESTAMP, queryLatency * 2, &queries[0][0]);
+    queriesCreated = true;
+
+    frames.clear();
+    collectedFrames = 0;
+}
+
+void FrameRecorder::deleteQueries()
+{
+    if(!queriesCreated)
+        return;
+
+    glDeleteQueries(queryLatency * 2, &queries[0][0]);
+    queriesCreated = false;
+}
+
+void FrameRecorder::beginFrame()
+{
+    // The slot about to be reused holds the frame from queryLatency frames
+    // ago, which the GPU has almost certainly finished by now
+    int frame = frames.size();
+    if(frame >= queryLatency)
+    {
+        collect(frame - queryLatency);
+    }
+
+    glQueryCounter(queries[frame % queryLatency][0], GL_TIMESTAMP);
+    frameStart = chrono::steady_clock::now();
+}
+
+void FrameRecorder::endFrame()
+{
+    int frame = frames.size();
+    glQueryCounter(queries[frame % queryLatency][1], GL_TIMESTAMP);
+
+    FrameTime time;
+    time.cpuMilliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - frameStart).count();
+    time.gpuMilliseconds = 0.0;
+    frames.push_back(time);
+}
+
+// Waits for the results of every frame still in flight
+void FrameRecorder::finish()
+{
+    while(collectedFrames < (int) frames.size())
+    {
+        collect(collectedFrames);
+    }
+}
+
+void FrameRecorder::collect(int frame)
+{
+    if(frame < collectedFrames)
+        return;
+
+    GLuint64 start = 0;
+    GLuint64 end = 0;
+    glGetQueryObjectui64v(queries[frame % queryLatency][0], GL_QUERY_RESULT, &start);
+    glGetQueryObjectui64v(queries[frame % queryLatency][1], GL_QUERY_RESULT, &end);
+
+    frames[frame].gpuMilliseconds = (end - start) / 1000000.0;
+    collectedFrames = frame + 1;
+}
+
+void FrameRecorder::setProperty(string name, string value)
+{
+    properties.push_back(make_pair(name, value));
+}
+
+int FrameRecorder::getFrameCount()
+{
+    return frames.size();
+}
+
+FrameTimeSummary FrameRecorder::getCpuSummary()
+{
+    return summarize(false);
+}
+
+FrameTimeSummary FrameRecorder::getGpuSummary()
+{
+    return summarize(true);
+}
+
+// Percentiles use the nearest rank, so each one is a frame that happened
+FrameTimeSummary FrameRecorder::summarize(bool gpu)
+{
+    FrameTimeSummary summary = FrameTimeSummary();
+    if(frames.empty())
+        return summary;
+
+    vector<double> sorted;
+    for(FrameTime& frame : frames)
+    {
+        sorted.push_back(gpu ? frame.gpuMilliseconds : frame.cpuMilliseconds);
+        summary.mean += sorted.back();
+    }
+    sort(sorted.begin(), sorted.end());
+
+    double percentiles[] = {0.5, 0.95, 0.99};
+    double* results[] = {&summary.p50, &summary.p95, &summary.p99};
+    for(int i = 0; i < 3; i++)
+    {
+        int rank = (int) ceil(percentiles[i] * sorted.size()) - 1;
+        *results[i] = sorted[max(0, min(rank, (int) sorted.size() - 1))];
+    }
+
+    summary.mean /= sorted.size();
+    summary.maximum = sorted.back();
+
+    return summary;
+}
+
+bool FrameRecorder::writeCsv(string filename)
+{
+    FILE* file = fopen(filename.c_str(), "w");
+    if(file == NULL)
+        return false;
+
+    fprintf(file, "frame,cpu_ms,gpu_ms\n");
+    for(int i = 0; i < (int) frames.size(); i++)
+    {
+        fprintf(file, "%d,%.4f,%.4f\n", i, frames[i].cpuMilliseconds, frames[i].gpuMilliseconds);
+    }
+
+    return fclose(file) == 0;
+}
+
+static void writeJsonSummary(FILE* file, const char* name, FrameTimeSummary summary)
+{
+    fprintf(file, "  \"%s\": {\"mean\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f},\n",
+            name, summary.mean, summary.p50, summary.p95, summary.p99, summary.maximum);
+}
+
+bool FrameRecorder::writeJson(string filename)
+{
+    FILE* file = fopen(filename.c_str(), "w");
+    if(file == NULL)
+        return false;
+
+    fprintf(file, "{\n");
+    for(auto& property : properties)
+    {
+        fprintf(file, "  ");
+        JsonWriter::writeString(file, property.first);
+        fprintf(file, ": ");
+        JsonWriter::writeString(file, property.second);
+        fprintf(file, ",\n");
+    }
+
+    fprintf(file, "  \"frames\": %d,\n", (int) frames.size());
+    writeJsonSummary(file, "cpu", getCpuSummary());
+    writeJsonSummary(file, "gpu", getGpuSummary());
+
+    fprintf(file, "  \"frameTimes\": [");
+    for(int i = 0; i < (int) frames.size(); i++)
+    {
+        fprintf(file, "%s\n    {\"cpu\": %.4f, \"gpu\": %.4f}", i > 0 ? "," : "", frames[i].cpuMilliseconds, frames[i].gpuMilliseconds);
+    }
+    fprintf(file, "\n  ]\n}\n");
+
+    return fclose(file) == 0;
+}
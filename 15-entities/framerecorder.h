@@ -0,0 +1,63 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+struct FrameTime
+{
+    double cpuMilliseconds;
+    double gpuMilliseconds;
+};
+
+struct FrameTimeSummary
+{
+    double mean;
+    double p50;
+    double p95;
+    double p99;
+    double maximum;
+};
+
+// Records the CPU time of each frame and, through timestamp queries, the
+// time the GPU spent on it. Results are read a few frames late so waiting
+// for them never stalls the pipeline.
+class FrameRecorder
+{
+    public:
+        FrameRecorder();
+
+        void create();
+        void deleteQueries();
+
+        void beginFrame();
+        void endFrame();
+        void finish();
+
+        void setProperty(string name, string value);
+
+        int getFrameCount();
+        FrameTimeSummary getCpuSummary();
+        FrameTimeSummary getGpuSummary();
+
+        bool writeCsv(string filename);
+        bool writeJson(string filename);
+
+    private:
+        static const int queryLatency = 4;
+
+        GLuint queries[queryLatency][2];
+        bool queriesCreated;
+        int collectedFrames;
+
+        chrono::steady_clock::time_point frameStart;
+        vector<FrameTime> frames;
+        vector<pair<string, string>> properties;
+
+        void collect(int frame);
+        FrameTimeSummary summarize(bool gpu);
+};
@@ -0,0 +1,205 @@
+#include "geometrypool.h"
+
+#include <algorithm>
+
+GeometryPool::GeometryPool()
+{
+    allocationCount = 0;
+    boundVao = 0;
+
+    pageVertices = 1 << 20;
+    pageIndexBytes = 16 << 20;
+}
+
+void GeometryPool::setPageSize(GLsizei vertices, GLsizeiptr indexBytes)
+{
+    pageVertices = vertices;
+    pageIndexBytes = indexBytes;
+}
+
+bool GeometryPool::allocate(VertexFormat& format, GLsizei vertexCount, GLsizeiptr indexSize, GeometryAllocation& allocation)
+{
+    // Keep every index range 4-byte aligned, whatever the index type
+    GLsizeiptr alignedIndexSize = (indexSize + 3) & ~(GLsizeiptr) 3;
+
+    for(int i = 0; i <= (int) pages.size(); i++)
+    {
+        if(i == (int) pages.size())
+        {
+            if(createPage(format, vertexCount, alignedIndexSize) < 0)
+                return false;
+        }
+
+        GeometryPage& page = pages[i];
+        if(page.format.getLayout() != format.getLayout())
+            continue;
+
+        size_t vertexOffset;
+        if(!page.vertices.allocate(vertexCount, vertexOffset))
+            continue;
+
+        size_t indexOffset;
+        if(!page.indexBytes.allocate(alignedIndexSize, indexOffset))
+        {
+            page.vertices.free(vertexOffset, vertexCount);
+            continue;
+        }
+
+        allocation.page = i;
+        allocation.baseVertex = vertexOffset;
+        allocation.vertexCount = vertexCount;
+        allocation.indexOffset = indexOffset;
+        allocation.indexSize = alignedIndexSize;
+
+        allocationCount++;
+        return true;
+    }
+
+    return false;
+}
+
+void GeometryPool::upload(GeometryAllocation& allocation, const void* bufferData[], const void* indexData, GLsizeiptr indexSize, StagingBuffer* staging)
+{
+    GeometryPage& page = pages[allocation.page];
+
+    if(staging != NULL && staging->isCreated())
+    {
+        for(int i = 0; i < page.format.getBufferCount(); i++)
+        {
+            GLsizei stride = page.format.getStride(i);
+            staging->copyToBuffer(page.vertexBuffers[i], (GLintptr) allocation.baseVertex * stride, bufferData[i], (GLsizeiptr) allocation.vertexCount * stride);
+        }
+        staging->copyToBuffer(page.indexBuffer, allocation.indexOffset, indexData, indexSize);
+        return;
+    }
+
+    for(int i = 0; i < page.format.getBufferCount(); i++)
+    {
+        GLsizei stride = page.format.getStride(i);
+        glNamedBufferSubData(page.vertexBuffers[i], (GLintptr) allocation.baseVertex * stride, (GLsizeiptr) allocation.vertexCount * stride, bufferData[i]);
+    }
+
+    glNamedBufferSubData(page.indexBuffer, allocation.indexOffset, indexSize, indexData);
+}
+
+void GeometryPool::free(GeometryAllocation& allocation)
+{
+    if(allocation.page < 0 || allocation.page >= (int) pages.size())
+        return;
+
+    GeometryPage& page = pages[allocation.page];
+    page.vertices.free(allocation.baseVertex, allocation.vertexCount);
+    page.indexBytes.free(allocation.indexOffset, allocation.indexSize);
+
+    allocation.page = -1;
+    allocationCount--;
+}
+
+// Models sharing a page draw without changing any state. This relies on
+// nothing else touching the vertex array binding until unbind() is called.
+void GeometryPool::bind(int page)
+{
+    GLuint vao = pages[page].vao;
+    if(vao != boundVao)
+    {
+        glBindVertexArray(vao);
+        boundVao = vao;
+    }
+}
+
+void GeometryPool::unbind()
+{
+    glBindVertexArray(0);
+    boundVao = 0;
+}
+
+void GeometryPool::deletePool()
+{
+    for(int i = 0; i < (int) pages.size(); i++)
+    {
+        glDeleteVertexArrays(1, &pages[i].vao);
+        glDeleteBuffers(pages[i].format.getBufferCount(), pages[i].vertexBuffers);
+        glDeleteBuffers(1, &pages[i].indexBuffer);
+    }
+
+    pages.clear();
+    allocationCount = 0;
+    boundVao = 0;
+}
+
+GeometryPoolStatistics GeometryPool::getStatistics()
+{
+    GeometryPoolStatistics statistics = GeometryPoolStatistics();
+    statistics.pageCount = pages.size();
+    statistics.allocationCount = allocationCount;
+
+    size_t largestFreeVertices = 0;
+    size_t largestFreeIndexBytes = 0;
+    for(int i = 0; i < (int) pages.size(); i++)
+    {
+        GeometryPage& page = pages[i];
+        statistics.vertexCapacity += page.vertices.getCapacity();
+        statistics.verticesUsed += page.vertices.getUsed();
+        statistics.indexCapacity += page.indexBytes.getCapacity();
+        statistics.indexBytesUsed += page.indexBytes.getUsed();
+
+        largestFreeVertices = max(largestFreeVertices, page.vertices.getLargestFreeRange());
+        largestFreeIndexBytes = max(largestFreeIndexBytes, page.indexBytes.getLargestFreeRange());
+    }
+
+    size_t freeVertices = statistics.vertexCapacity - statistics.verticesUsed;
+    size_t freeIndexBytes = statistics.indexCapacity - statistics.indexBytesUsed;
+    if(freeVertices > 0)
+    {
+        statistics.vertexFragmentation = 1.0f - (float) largestFreeVertices / freeVertices;
+    }
+    if(freeIndexBytes > 0)
+    {
+        statistics.indexFragmentation = 1.0f - (float) largestFreeIndexBytes / freeIndexBytes;
+    }
+
+    return statistics;
+}
+
+string GeometryPool::getError()
+{
+    return errorMessage;
+}
+
+int GeometryPool::createPage(VertexFormat& format, GLsizei vertexCount, GLsizeiptr indexSize)
+{
+    // Clear older errors so the check below only sees this allocation
+    while(glGetError() != GL_NO_ERROR)
+    {
+    }
+
+    // Meshes larger than a page get a page of their own
+    GeometryPage page;
+    page.format = format;
+    page.vertices.init(max(pageVertices, vertexCount));
+    page.indexBytes.init(max(pageIndexBytes, indexSize));
+
+    glCreateBuffers(format.getBufferCount(), page.vertexBuffers);
+    for(int i = 0; i < format.getBufferCount(); i++)
+    {
+        glNamedBufferStorage(page.vertexBuffers[i], (GLsizeiptr) page.vertices.getCapacity() * format.getStride(i), NULL, GL_DYNAMIC_STORAGE_BIT);
+    }
+
+    glCreateBuffers(1, &page.indexBuffer);
+    glNamedBufferStorage(page.indexBuffer, page.indexBytes.getCapacity(), NULL, GL_DYNAMIC_STORAGE_BIT);
+
+    if(glGetError() != GL_NO_ERROR)
+    {
+        glDeleteBuffers(format.getBufferCount(), page.vertexBuffers);
+        glDeleteBuffers(1, &page.indexBuffer);
+        errorMessage = "Unable to allocate geometry pool page";
+        return -1;
+    }
+
+    glCreateVertexArrays(1, &page.vao);
+    format.setupAttributes(page.vao, page.vertexBuffers);
+    glVertexArrayElementBuffer(page.vao, page.indexBuffer);
+
+    pages.push_back(page);
+    return pages.size() - 1;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "rangeallocator.h"
+#include "stagingbuffer.h"
+#include "vertexformat.h"
+
+#include <GL/glew.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+struct GeometryAllocation
+{
+    int page;
+    GLint baseVertex;
+    GLsizei vertexCount;
+    GLintptr indexOffset;
+    GLsizeiptr indexSize;
+};
+
+// The command layout read by glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand
+{
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+struct GeometryPoolStatistics
+{
+    int pageCount;
+    int allocationCount;
+
+    size_t vertexCapacity;
+    size_t verticesUsed;
+    size_t indexCapacity;
+    size_t indexBytesUsed;
+
+    // One minus the largest free range over all free space, so 0 means the
+    // free space is a single block
+    float vertexFragmentation;
+    float indexFragmentation;
+};
+
+class GeometryPool
+{
+    public:
+        GeometryPool();
+
+        void setPageSize(GLsizei vertices, GLsizeiptr indexBytes);
+
+        bool allocate(VertexFormat& format, GLsizei vertexCount, GLsizeiptr indexSize, GeometryAllocation& allocation);
+        void upload(GeometryAllocation& allocation, const void* bufferData[], const void* indexData, GLsizeiptr indexSize, StagingBuffer* staging = NULL);
+        void free(GeometryAllocation& allocation);
+
+        void bind(int page);
+        void unbind();
+        void deletePool();
+
+        GeometryPoolStatistics getStatistics();
+        string getError();
+
+    private:
+        struct GeometryPage
+        {
+            VertexFormat format;
+            GLuint vao;
+            GLuint vertexBuffers[VertexFormat::maxBuffers];
+            GLuint indexBuffer;
+
+            RangeAllocator vertices;
+            RangeAllocator indexBytes;
+        };
+
+        vector<GeometryPage> pages;
+        int allocationCount;
+        GLuint boundVao;
+
+        GLsizei pageVertices;
+        GLsizeiptr pageIndexBytes;
+
+        string errorMessage;
+
+        int createPage(VertexFormat& format, GLsizei vertexCount, GLsizeiptr indexSize);
+};
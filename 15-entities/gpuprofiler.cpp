@@ -0,0 +1,225 @@
+#include "gpuprofiler.h"
+
+GpuProfiler::GpuProfiler()
+{
+    for(int i = 0; i < frameLatency; i++)
+    {
+        frames[i].lastQuery = 0;
+        frames[i].pending = false;
+    }
+
+    currentFrame = 0;
+    created = false;
+    frameOpen = false;
+    droppedFrames = 0;
+}
+
+void GpuProfiler::create()
+{
+    deleteQueries();
+    created = true;
+}
+
+void GpuProfiler::deleteQueries()
+{
+    for(int i = 0; i < frameLatency; i++)
+    {
+        if(!frames[i].queries.empty())
+        {
+            glDeleteQueries(frames[i].queries.size(), &frames[i].queries[0]);
+        }
+        frames[i].queries.clear();
+        frames[i].zones.clear();
+        frames[i].lastQuery = 0;
+        frames[i].pending = false;
+    }
+
+    created = false;
+    frameOpen = false;
+    openZones.clear();
+}
+
+void GpuProfiler::beginFrame()
+{
+    if(!created)
+        return;
+
+    // The slot about to be reused was recorded frameLatency frames ago
+    GpuProfilerFrame& frame = frames[currentFrame];
+    if(frame.pending)
+    {
+        collect(frame);
+    }
+
+    frame.zones.clear();
+    frame.lastQuery = 0;
+    frame.pending = false;
+    frameOpen = true;
+    openZones.clear();
+}
+
+void GpuProfiler::endFrame()
+{
+    if(!frameOpen)
+        return;
+
+    while(!openZones.empty())
+    {
+        endZone();
+    }
+
+    frames[currentFrame].pending = !frames[currentFrame].zones.empty();
+    currentFrame = (currentFrame + 1) % frameLatency;
+    frameOpen = false;
+}
+
+// Zones nest, so timestamps are used rather than GL_TIME_ELAPSED queries,
+// which cannot be active inside one another
+void GpuProfiler::beginZone(string name)
+{
+    if(!frameOpen)
+        return;
+
+    GpuProfilerFrame& frame = frames[currentFrame];
+
+    GpuZone zone = GpuZone();
+    zone.name = name;
+    zone.path = name;
+    zone.depth = openZones.size();
+    zone.parent = -1;
+    if(!openZones.empty())
+    {
+        zone.parent = openZones.back();
+        zone.path = frame.zones[zone.parent].path + "/" + name;
+    }
+
+    int index = frame.zones.size();
+    frame.zones.push_back(zone);
+    openZones.push_back(index);
+
+    reserveQueries(frame, (index + 1) * 2);
+    frame.lastQuery = frame.queries[index * 2];
+    glQueryCounter(frame.lastQuery, GL_TIMESTAMP);
+}
+
+void GpuProfiler::endZone()
+{
+    if(!frameOpen || openZones.empty())
+        return;
+
+    int index = openZones.back();
+    openZones.pop_back();
+
+    GpuProfilerFrame& frame = frames[currentFrame];
+    frame.lastQuery = frame.queries[index * 2 + 1];
+    glQueryCounter(frame.lastQuery, GL_TIMESTAMP);
+}
+
+void GpuProfiler::reserveQueries(GpuProfilerFrame& frame, int count)
+{
+    int existing = frame.queries.size();
+    if(count <= existing)
+        return;
+
+    frame.queries.resize(count);
+    glCreateQueries(GL_TIMESTAMP, count - existing, &frame.queries[existing]);
+}
+
+void GpuProfiler::collect(GpuProfilerFrame& frame)
+{
+    frame.pending = false;
+
+    // Queries complete in the order they were issued, so the last one
+    // issued being ready means they all are. That is the end of the
+    // outermost zone, not the end of the last zone to begin.
+    GLint available = 0;
+    glGetQueryObjectiv(frame.lastQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+    if(!available)
+    {
+        droppedFrames++;
+        return;
+    }
+
+    for(int i = 0; i < (int) frame.zones.size(); i++)
+    {
+        GLuint64 start = 0;
+        GLuint64 end = 0;
+        glGetQueryObjectui64v(frame.queries[i * 2], GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(frame.queries[i * 2 + 1], GL_QUERY_RESULT, &end);
+
+        frame.zones[i].milliseconds = end > start ? (end - start) / 1000000.0 : 0.0;
+        addSample(frame.zones[i]);
+    }
+
+    latestZones = frame.zones;
+}
+
+void GpuProfiler::addSample(GpuZone& zone)
+{
+    auto existing = histories.find(zone.path);
+    if(existing == histories.end())
+    {
+        GpuZoneHistory history = GpuZoneHistory();
+        history.name = zone.name;
+        history.depth = zone.depth;
+        existing = histories.insert(make_pair(zone.path, history)).first;
+
+        // A zone first seen late still goes after its parent's other
+        // children, so the averages read as a tree
+        int position = averageOrder.size();
+        if(zone.parent >= 0)
+        {
+            string parentPath = zone.path.substr(0, zone.path.size() - zone.name.size() - 1);
+            for(int i = 0; i < (int) averageOrder.size(); i++)
+            {
+                if(averageOrder[i] == parentPath || averageOrder[i].compare(0, parentPath.size() + 1, parentPath + "/") == 0)
+                    position = i + 1;
+            }
+        }
+        averageOrder.insert(averageOrder.begin() + position, zone.path);
+    }
+
+    GpuZoneHistory& history = existing->second;
+    if((int) history.samples.size() < averageFrames)
+    {
+        history.samples.push_back(zone.milliseconds);
+    }
+    else
+    {
+        history.total -= history.samples[history.next];
+        history.samples[history.next] = zone.milliseconds;
+        history.next = (history.next + 1) % averageFrames;
+    }
+    history.total += zone.milliseconds;
+}
+
+// The zones of the most recent frame whose results have been read, in the
+// order they began, so each zone's children follow it
+vector<GpuZone> GpuProfiler::getFrameZones()
+{
+    return latestZones;
+}
+
+// The mean time of every zone seen so far over its last averageFrames
+// samples, with each zone's children following it
+vector<GpuZoneAverage> GpuProfiler::getAverages()
+{
+    vector<GpuZoneAverage> averages;
+    for(string& path : averageOrder)
+    {
+        GpuZoneHistory& history = histories[path];
+
+        GpuZoneAverage average = GpuZoneAverage();
+        average.path = path;
+        average.name = history.name;
+        average.depth = history.depth;
+        average.milliseconds = history.total / history.samples.size();
+        averages.push_back(average);
+    }
+    return averages;
+}
+
+int GpuProfiler::getDroppedFrames()
+{
+    return droppedFrames;
+}
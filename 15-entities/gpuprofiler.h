@@ -0,0 +1,82 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+struct GpuZone
+{
+    string name;
+    string path;
+    int depth;
+    int parent;
+    double milliseconds;
+};
+
+struct GpuZoneAverage
+{
+    string path;
+    string name;
+    int depth;
+    double milliseconds;
+};
+
+struct GpuProfilerFrame
+{
+    vector<GpuZone> zones;
+    vector<GLuint> queries;
+    GLuint lastQuery;
+    bool pending;
+};
+
+struct GpuZoneHistory
+{
+    string name;
+    int depth;
+    vector<double> samples;
+    int next;
+    double total;
+};
+
+// Times named, nested zones of GL commands with pairs of timestamp queries.
+// Each frame's queries are read back frameLatency frames later, and a frame
+// whose results still are not ready is dropped rather than waited for.
+class GpuProfiler
+{
+    public:
+        GpuProfiler();
+
+        void create();
+        void deleteQueries();
+
+        void beginFrame();
+        void endFrame();
+        void beginZone(string name);
+        void endZone();
+
+        vector<GpuZone> getFrameZones();
+        vector<GpuZoneAverage> getAverages();
+        int getDroppedFrames();
+
+    private:
+        static const int frameLatency = 3;
+        static const int averageFrames = 60;
+
+        GpuProfilerFrame frames[frameLatency];
+        int currentFrame;
+        bool created;
+        bool frameOpen;
+        vector<int> openZones;
+
+        vector<GpuZone> latestZones;
+        map<string, GpuZoneHistory> histories;
+        vector<string> averageOrder;
+        int droppedFrames;
+
+        void reserveQueries(GpuProfilerFrame& frame, int count);
+        void collect(GpuProfilerFrame& frame);
+        void addSample(GpuZone& zone);
+};
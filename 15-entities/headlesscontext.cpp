@@ -0,0 +1,141 @@
+#include "headlesscontext.h"
+
+#ifdef __linux__
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <string.h>
+#endif
+
+HeadlessContext::HeadlessContext()
+{
+    display = NULL;
+    context = NULL;
+    surface = NULL;
+}
+
+// Creates an OpenGL core context with no window. The surfaceless platform
+// needs neither a display server nor a GPU, so it also runs on Mesa's
+// llvmpipe software renderer, which only offers OpenGL 4.5.
+bool HeadlessContext::create()
+{
+    destroy();
+
+#ifdef __linux__
+    EGLDisplay eglDisplay = EGL_NO_DISPLAY;
+
+    const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if(clientExtensions != NULL && strstr(clientExtensions, "EGL_MESA_platform_surfaceless") != NULL && getPlatformDisplay != NULL)
+    {
+        eglDisplay = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    }
+    if(eglDisplay == EGL_NO_DISPLAY)
+    {
+        eglDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+
+    if(eglDisplay == EGL_NO_DISPLAY || !eglInitialize(eglDisplay, NULL, NULL))
+    {
+        errorMessage = "Unable to initialise an EGL display";
+        return false;
+    }
+    display = eglDisplay;
+
+    if(!eglBindAPI(EGL_OPENGL_API))
+    {
+        errorMessage = "EGL display does not support OpenGL";
+        destroy();
+        return false;
+    }
+
+    // The surfaceless platform has no configs with pbuffer support, so a
+    // config is only needed when falling back to a pbuffer surface
+    const char* displayExtensions = eglQueryString(eglDisplay, EGL_EXTENSIONS);
+    bool surfaceless = displayExtensions != NULL && strstr(displayExtensions, "EGL_KHR_surfaceless_context") != NULL &&
+                       strstr(displayExtensions, "EGL_KHR_no_config_context") != NULL;
+
+    EGLConfig config = EGL_NO_CONFIG_KHR;
+    if(!surfaceless)
+    {
+        EGLint configAttributes[] = {EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+                                     EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_NONE};
+        EGLint configCount = 0;
+        if(!eglChooseConfig(eglDisplay, configAttributes, &config, 1, &configCount) || configCount == 0)
+        {
+            errorMessage = "Unable to find an EGL config for a pbuffer";
+            destroy();
+            return false;
+        }
+
+        EGLint pbufferAttributes[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+        surface = eglCreatePbufferSurface(eglDisplay, config, pbufferAttributes);
+        if(surface == EGL_NO_SURFACE)
+        {
+            errorMessage = "Unable to create an EGL pbuffer";
+            destroy();
+            return false;
+        }
+    }
+
+    int minorVersions[] = {6, 5};
+    for(int minorVersion : minorVersions)
+    {
+        EGLint contextAttributes[] = {EGL_CONTEXT_MAJOR_VERSION, 4, EGL_CONTEXT_MINOR_VERSION, minorVersion,
+                                      EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT, EGL_NONE};
+        context = eglCreateContext(eglDisplay, config, EGL_NO_CONTEXT, contextAttributes);
+        if(context != EGL_NO_CONTEXT)
+            break;
+    }
+
+    if(context == EGL_NO_CONTEXT)
+    {
+        context = NULL;
+        errorMessage = "Unable to create an OpenGL 4.5 context with EGL";
+        destroy();
+        return false;
+    }
+
+    EGLSurface eglSurface = surface != NULL ? (EGLSurface) surface : EGL_NO_SURFACE;
+    if(!eglMakeCurrent(eglDisplay, eglSurface, eglSurface, (EGLContext) context))
+    {
+        errorMessage = "Unable to make the EGL context current";
+        destroy();
+        return false;
+    }
+
+    return true;
+#else
+    errorMessage = "Headless rendering needs EGL, which is only used on Linux";
+    return false;
+#endif
+}
+
+void HeadlessContext::destroy()
+{
+#ifdef __linux__
+    if(display != NULL)
+    {
+        EGLDisplay eglDisplay = (EGLDisplay) display;
+        eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+
+        if(context != NULL)
+        {
+            eglDestroyContext(eglDisplay, (EGLContext) context);
+        }
+        if(surface != NULL)
+        {
+            eglDestroySurface(eglDisplay, (EGLSurface) surface);
+        }
+        eglTerminate(eglDisplay);
+    }
+#endif
+
+    display = NULL;
+    context = NULL;
+    surface = NULL;
+}
+
+string HeadlessContext::getError()
+{
+    return errorMessage;
+}
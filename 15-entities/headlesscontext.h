@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+
+using namespace std;
+
+class HeadlessContext
+{
+    public:
+        HeadlessContext();
+
+        bool create();
+        void destroy();
+
+        string getError();
+
+    private:
+        // EGL handles, kept opaque so EGL headers stay out of this header
+        void* display;
+        void* context;
+        void* surface;
+
+        string errorMessage;
+};
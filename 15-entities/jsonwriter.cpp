@@ -0,0 +1,24 @@
+#include "jsonwriter.h"
+
+// Writes text as a quoted JSON string, escaping quotes, backslashes and
+// control characters such as the newlines in error messages
+void JsonWriter::writeString(FILE* file, const string& text)
+{
+    fputc('"', file);
+    for(char character : text)
+    {
+        if(character == '"' || character == '\\')
+        {
+            fprintf(file, "\\%c", character);
+        }
+        else if((unsigned char) character < 0x20)
+        {
+            fprintf(file, "\\u%04x", character);
+        }
+        else
+        {
+            fputc(character, file);
+        }
+    }
+    fputc('"', file);
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <stdio.h>
+#include <string>
+
+using namespace std;
+
+class JsonWriter
+{
+    public:
+        static void writeString(FILE* file, const string& text);
+};
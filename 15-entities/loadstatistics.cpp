@@ -0,0 +1,178 @@
+#include "loadstatistics.h"
+#include "jsonwriter.h"
+#include "trace.h"
+
+#include <stdio.h>
+
+static thread_local size_t threadAllocations = 0;
+static thread_local size_t threadAllocatedBytes = 0;
+
+mutex LoadStatistics::recordsMutex;
+vector<LoadRecord> LoadStatistics::records;
+bool LoadStatistics::countingAllocations = false;
+
+LoadTimer::LoadTimer()
+{
+    start();
+}
+
+void LoadTimer::start()
+{
+    phaseStart = chrono::steady_clock::now();
+    allocationStart = threadAllocations;
+    allocatedBytesStart = threadAllocatedBytes;
+}
+
+void LoadTimer::endPhase(LoadRecord& record, LoadPhase phase)
+{
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+    record.phaseSeconds[phase] += chrono::duration<double>(now - phaseStart).count();
+    TRACE_EVENT(LoadStatistics::getPhaseName(phase), phaseStart, now);
+
+    size_t allocations = threadAllocations - allocationStart;
+    record.phaseAllocations[phase] += allocations;
+    record.allocations += allocations;
+    record.allocatedBytes += threadAllocatedBytes - allocatedBytesStart;
+
+    start();
+}
+
+void LoadStatistics::begin(LoadRecord& record, string type, string name)
+{
+    record = LoadRecord();
+    record.type = type;
+    record.name = name;
+}
+
+void LoadStatistics::add(LoadRecord& record, bool succeeded)
+{
+    record.succeeded = succeeded;
+
+    lock_guard<mutex> lock(recordsMutex);
+    records.push_back(record);
+}
+
+vector<LoadRecord> LoadStatistics::getRecords()
+{
+    lock_guard<mutex> lock(recordsMutex);
+    return records;
+}
+
+LoadRecord LoadStatistics::getTotals()
+{
+    LoadRecord totals = LoadRecord();
+    totals.type = "total";
+    totals.succeeded = true;
+
+    lock_guard<mutex> lock(recordsMutex);
+    for(LoadRecord& record : records)
+    {
+        for(int phase = 0; phase < LOAD_PHASE_COUNT; phase++)
+        {
+            totals.phaseSeconds[phase] += record.phaseSeconds[phase];
+            totals.phaseAllocations[phase] += record.phaseAllocations[phase];
+        }
+
+        totals.bytesRead += record.bytesRead;
+        totals.bytesUploaded += record.bytesUploaded;
+        totals.allocations += record.allocations;
+        totals.allocatedBytes += record.allocatedBytes;
+        totals.succeeded = totals.succeeded && record.succeeded;
+    }
+
+    return totals;
+}
+
+void LoadStatistics::clear()
+{
+    lock_guard<mutex> lock(recordsMutex);
+    records.clear();
+}
+
+static void writeJsonRecord(FILE* file, const LoadRecord& record)
+{
+    fprintf(file, "{\"type\": ");
+    JsonWriter::writeString(file, record.type);
+    fprintf(file, ", \"name\": ");
+    JsonWriter::writeString(file, record.name);
+    fprintf(file, ", \"succeeded\": %s, \"fromCache\": %s", record.succeeded ? "true" : "false", record.fromCache ? "true" : "false");
+
+    double totalSeconds = 0.0;
+    fprintf(file, ", \"phases\": {");
+    for(int phase = 0; phase < LOAD_PHASE_COUNT; phase++)
+    {
+        fprintf(file, "%s\"%s\": {\"seconds\": %.9f, \"allocations\": %zu}", phase > 0 ? ", " : "",
+                LoadStatistics::getPhaseName((LoadPhase) phase), record.phaseSeconds[phase], record.phaseAllocations[phase]);
+        totalSeconds += record.phaseSeconds[phase];
+    }
+    fprintf(file, "}");
+
+    fprintf(file, ", \"seconds\": %.9f, \"bytesRead\": %zu, \"bytesUploaded\": %zu, \"allocations\": %zu, \"allocatedBytes\": %zu",
+            totalSeconds, record.bytesRead, record.bytesUploaded, record.allocations, record.allocatedBytes);
+
+    if(record.type == "model")
+    {
+        fprintf(file, ", \"acmrBefore\": %.4f, \"acmrAfter\": %.4f", record.acmrBefore, record.acmrAfter);
+        fprintf(file, ", \"vertexMemorySaved\": %zu, \"maxPositionError\": %.9f, \"maxNormalError\": %.9f",
+                record.vertexMemorySaved, record.maxPositionError, record.maxNormalError);
+    }
+    fprintf(file, "}");
+}
+
+bool LoadStatistics::writeJson(string filename)
+{
+    FILE* file = fopen(filename.c_str(), "w");
+    if(file == NULL)
+        return false;
+
+    vector<LoadRecord> allRecords = getRecords();
+
+    fprintf(file, "{\n  \"allocationsCounted\": %s,\n  \"loads\": [\n", countingAllocations ? "true" : "false");
+    for(int i = 0; i < (int) allRecords.size(); i++)
+    {
+        fprintf(file, "    ");
+        writeJsonRecord(file, allRecords[i]);
+        fprintf(file, "%s\n", i + 1 < (int) allRecords.size() ? "," : "");
+    }
+    fprintf(file, "  ],\n  \"total\": ");
+    writeJsonRecord(file, getTotals());
+    fprintf(file, "\n}\n");
+
+    return fclose(file) == 0;
+}
+
+const char* LoadStatistics::getPhaseName(LoadPhase phase)
+{
+    static const char* phaseNames[LOAD_PHASE_COUNT] = {"read", "parse", "deduplicate", "process", "cache", "upload"};
+    if(phase < 0 || phase >= LOAD_PHASE_COUNT)
+        return "unknown";
+
+    return phaseNames[phase];
+}
+
+// Called for every allocation once allocationcounter.cpp is linked in
+void LoadStatistics::countAllocation(size_t size)
+{
+    threadAllocations++;
+    threadAllocatedBytes += size;
+}
+
+void LoadStatistics::setCountingAllocations(bool counting)
+{
+    countingAllocations = counting;
+}
+
+bool LoadStatistics::isCountingAllocations()
+{
+    return countingAllocations;
+}
+
+size_t LoadStatistics::getThreadAllocations()
+{
+    return threadAllocations;
+}
+
+size_t LoadStatistics::getThreadAllocatedBytes()
+{
+    return threadAllocatedBytes;
+}
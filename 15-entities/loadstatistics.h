@@ -0,0 +1,91 @@
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+enum LoadPhase
+{
+    LOAD_PHASE_READ,
+    LOAD_PHASE_PARSE,
+    LOAD_PHASE_DEDUPLICATE,
+    LOAD_PHASE_PROCESS,
+    LOAD_PHASE_CACHE,
+    LOAD_PHASE_UPLOAD,
+    LOAD_PHASE_COUNT
+};
+
+// One load of one asset. Allocations are only counted in builds that link
+// allocationcounter.cpp, and then only operator new calls made on the
+// thread running each phase, not those of worker threads it waits on or of
+// C libraries calling malloc directly.
+struct LoadRecord
+{
+    string type;
+    string name;
+    bool succeeded;
+    bool fromCache;
+
+    double phaseSeconds[LOAD_PHASE_COUNT];
+    size_t phaseAllocations[LOAD_PHASE_COUNT];
+
+    size_t bytesRead;
+    size_t bytesUploaded;
+    size_t allocations;
+    size_t allocatedBytes;
+
+    // Average vertex cache misses per triangle, left at zero for models
+    // loaded without the optimizer
+    float acmrBefore;
+    float acmrAfter;
+
+    // Bytes saved against eight floats per vertex, and the largest error
+    // quantization introduced to any position or normal component
+    size_t vertexMemorySaved;
+    float maxPositionError;
+    float maxNormalError;
+};
+
+// Times consecutive phases of a load on one thread. Each call to
+// endPhase() charges everything since the previous call to that phase.
+class LoadTimer
+{
+    public:
+        LoadTimer();
+
+        void start();
+        void endPhase(LoadRecord& record, LoadPhase phase);
+
+    private:
+        chrono::steady_clock::time_point phaseStart;
+        size_t allocationStart;
+        size_t allocatedBytesStart;
+};
+
+class LoadStatistics
+{
+    public:
+        static void begin(LoadRecord& record, string type, string name);
+        static void add(LoadRecord& record, bool succeeded);
+
+        static vector<LoadRecord> getRecords();
+        static LoadRecord getTotals();
+        static void clear();
+        static bool writeJson(string filename);
+
+        static const char* getPhaseName(LoadPhase phase);
+        static size_t getThreadAllocations();
+        static size_t getThreadAllocatedBytes();
+
+        static void countAllocation(size_t size);
+        static void setCountingAllocations(bool counting);
+        static bool isCountingAllocations();
+
+    private:
+        static mutex recordsMutex;
+        static vector<LoadRecord> records;
+        static bool countingAllocations;
+};
@@ -2,6 +2,19 @@
 #include "texture.h"
 #include "model.h"
 #include "entity.h"
+#include "threadpool.h"
+#include "assetloader.h"
+#include "assetmanager.h"
+#include "geometrypool.h"
+#include "filewatcher.h"
+#include "loadstatistics.h"
+#include "headlesscontext.h"
+#include "framebuffer.h"
+#include "camerapath.h"
+#include "framerecorder.h"
+#include "gpuprofiler.h"
+#include "renderer.h"
+#include "trace.h"
 
 #include <SDL3/SDL.h>
 #include <SDL3/SDL_main.h>
@@ -12,6 +25,8 @@
 
 #include <string>
 #include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
 
 int windowWidth = 1024;
 int windowHeight = 600;
@@ -22,10 +37,39 @@ float movementSpeed = 5.0;
 SDL_Window* window = NULL;
 SDL_GLContext context = NULL;
 
+// Headless mode renders into a framebuffer with no window, for benchmarks
+// and image checks on machines without a display
+bool headless = false;
+HeadlessContext headlessContext;
+Framebuffer framebuffer;
+
+int framesToRender = 0;
+int framesRendered = 0;
+Uint64 renderingStart = 0;
+string screenshotFilename;
+
+// A camera path replaces keyboard and mouse control, and is sampled at a
+// fixed rate so every run draws exactly the same frames
+CameraPath cameraPath;
+string cameraPathFilename;
+const float cameraPathFrameRate = 60.0f;
+
+FrameRecorder frameRecorder;
+bool measuringFrame = false;
+string benchmarkOutput;
+
+GpuProfiler gpuProfiler;
+
+string traceFilename;
+VertexLayout modelLayout = VERTEX_LAYOUT_SEPARATE;
+bool optimizeModels = false;
+
 bool programRunning = true;
 bool isFullscreen = false;
 bool useWireframe = false;
+bool showNormals = false;
 Uint64 previousTimestamp = 0;
+string loadStatisticsFilename;
 
 float x = 0;
 float y = 0;
@@ -33,12 +77,23 @@ float z = 1.8;
 float pitch = 0;
 float yaw = 0;
 
-Shader mainShader;
-Texture crateTexture;
-Model crateModel;
+ThreadPool workerPool;
+AssetLoader assetLoader;
+StagingBuffer stagingBuffer;
+GeometryPool geometryPool;
+FileWatcher fileWatcher;
+
+AssetManager assetManager;
+Shader* mainShader = NULL;
 Entity crate1, crate2, crate3;
 
-bool init()
+// --crate-grid <n> adds an n by n grid of crates behind the stack
+vector<Entity> crateGrid;
+int crateGridSize = 0;
+
+Renderer renderer;
+
+bool createWindow()
 {
     if(!SDL_Init(SDL_INIT_VIDEO))
     {
@@ -54,7 +109,7 @@ bool init()
     SDL_SetNumberProperty(properties, SDL_PROP_WINDOW_CREATE_WIDTH_NUMBER, windowWidth);
     SDL_SetNumberProperty(properties, SDL_PROP_WINDOW_CREATE_HEIGHT_NUMBER, windowHeight);
     SDL_SetBooleanProperty(properties, SDL_PROP_WINDOW_CREATE_OPENGL_BOOLEAN, true);
-    SDL_SetBooleanProperty(properties, SDL_PROP_WINDOW_CREATE_RESIZABLE_BOOLEAN, true);
+    SDL_SetBooleanProperty(properties, SDL_PROP_WINDOW_CREATE_RESIZABLE_BOOLEAN, cameraPathFilename.empty());
 
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 6);
@@ -91,61 +146,151 @@ bool init()
         return false;
     }
 
+    return true;
+}
+
+bool createHeadlessContext()
+{
+    if(!SDL_Init(0))
+    {
+        printf("Unable to initialise SDL: %s\n", SDL_GetError());
+        return false;
+    }
+
+    if(!headlessContext.create())
+    {
+        printf("Unable to create a headless context: %s\n", headlessContext.getError().c_str());
+        return false;
+    }
+
+    return true;
+}
+
+bool init()
+{
+    TRACE_ZONE("init");
+
+    if(headless ? !createHeadlessContext() : !createWindow())
+        return false;
+
+    // GLEW built for GLX still loads every function under EGL, but then
+    // fails to find an X display for its GLX extensions
     GLenum glewError = glewInit();
-    if(glewError != GLEW_OK)
+    if(glewError != GLEW_OK && !(headless && glewError == GLEW_ERROR_NO_GLX_DISPLAY))
     {
         printf("Unable to initialise GLEW: %s\n", glewGetErrorString(glewError));
         return false;
     }
 
+    // Software renderers such as llvmpipe stop at 4.5, which has everything
+    // the renderer uses
     int majorVersion, minorVersion;
-    SDL_GL_GetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, &majorVersion);
-    SDL_GL_GetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, &minorVersion);
-    if(majorVersion < 4 || (majorVersion == 4 && minorVersion < 6))
+    glGetIntegerv(GL_MAJOR_VERSION, &majorVersion);
+    glGetIntegerv(GL_MINOR_VERSION, &minorVersion);
+    int requiredMinorVersion = headless ? 5 : 6;
+    if(majorVersion < 4 || (majorVersion == 4 && minorVersion < requiredMinorVersion))
     {
         printf("Unable to get a recent OpenGL version!\n");
         return false;
     }
     printf("%s\n", glGetString(GL_VERSION));
 
-    mainShader.setFilenames("shaders/main_vertex.glsl", "shaders/main_fragment.glsl");
-    if(!mainShader.loadShader())
+    if(headless && !framebuffer.create(windowWidth, windowHeight))
     {
-        printf("Unable to create shader from files: %s\n", mainShader.getFilenames().c_str());
-        printf("Error message: %s\n", mainShader.getError().c_str());
+        printf("Unable to create framebuffer: %s\n", framebuffer.getError().c_str());
         return false;
     }
 
-    crateTexture.setFilename("resources/crate/diffuse.png");
-    if(!crateTexture.loadTexture())
+    gpuProfiler.create();
+
+    if(!cameraPathFilename.empty())
     {
-        printf("Unable to load texture: %s\n", crateTexture.getError().c_str());
-        return false;
+        if(!cameraPath.loadPath(cameraPathFilename))
+        {
+            printf("%s\n", cameraPath.getError().c_str());
+            return false;
+        }
+
+        if(framesToRender <= 0)
+        {
+            framesToRender = (int) ceil(cameraPath.getDuration() * cameraPathFrameRate) + 1;
+        }
     }
 
-    crateModel.setFilename("resources/crate/crate.obj");
-    if(!crateModel.loadOBJModel())
+    if(framesToRender > 0)
     {
-        printf("Unable to load model: %s\n", crateModel.getError().c_str());
+        const char* layoutNames[] = {"separate", "interleaved", "compressed"};
+
+        frameRecorder.create();
+        frameRecorder.setProperty("renderer", (const char*) glGetString(GL_RENDERER));
+        frameRecorder.setProperty("version", (const char*) glGetString(GL_VERSION));
+        frameRecorder.setProperty("resolution", to_string(windowWidth) + "x" + to_string(windowHeight));
+        frameRecorder.setProperty("cameraPath", cameraPathFilename);
+        frameRecorder.setProperty("vertexLayout", layoutNames[modelLayout]);
+        frameRecorder.setProperty("headless", headless ? "true" : "false");
+    }
+
+    if(!stagingBuffer.create(16 * 1024 * 1024))
+    {
+        printf("Unable to create staging buffer: %s\n", stagingBuffer.getError().c_str());
         return false;
     }
+    stagingBuffer.setFrameBudget(8 * 1024 * 1024);
+
+    workerPool.start(0);
 
-    crate1.setModel(&crateModel);
-    crate1.setTexture(&crateTexture);
+    // Edited assets are reloaded automatically, checking modification times
+    // where file notifications are unavailable
+    if(!fileWatcher.start())
+    {
+        printf("%s\n", fileWatcher.getError().c_str());
+    }
+    assetLoader.setThreadPool(&workerPool);
+    assetLoader.setStagingBuffer(&stagingBuffer);
+
+    assetManager.setAssetLoader(&assetLoader);
+    assetManager.setThreadPool(&workerPool);
+    assetManager.setGeometryPool(&geometryPool);
+    assetManager.setStagingBuffer(&stagingBuffer);
+    assetManager.setFileWatcher(&fileWatcher);
+    assetManager.setModelDefaults(modelLayout, optimizeModels, true, true);
+
+    // Assets load in the background and are uploaded as they finish, with
+    // entities skipped until their model and texture are ready. Each entity
+    // holds its own reference, but the crate files are only loaded once.
+    mainShader = assetManager.acquireShader("shaders/main_vertex.glsl", "shaders/main_fragment.glsl");
+
+    crate1.setModel(assetManager.acquireModel("resources/crate/crate.obj"));
+    crate1.setTexture(assetManager.acquireTexture("resources/crate/diffuse.png"));
     crate1.setPosition(6, 0.46, 0);
     crate1.setOrientation(0, 0, 5);
 
-    crate2.setModel(&crateModel);
-    crate2.setTexture(&crateTexture);
+    crate2.setModel(assetManager.acquireModel("resources/crate/crate.obj"));
+    crate2.setTexture(assetManager.acquireTexture("resources/crate/diffuse.png"));
     crate2.setPosition(6, -0.46, 0);
     crate2.setOrientation(0, 0, 83);
 
-    crate3.setModel(&crateModel);
-    crate3.setTexture(&crateTexture);
+    crate3.setModel(assetManager.acquireModel("resources/crate/crate.obj"));
+    crate3.setTexture(assetManager.acquireTexture("resources/crate/diffuse.png"));
     crate3.setPosition(6.03, 0, 0.7);
     crate3.setOrientation(0, 0, -2);
 
-    SDL_SetWindowRelativeMouseMode(window, true);
+    crateGrid.resize(crateGridSize * crateGridSize);
+    for(int i = 0; i < (int) crateGrid.size(); i++)
+    {
+        int row = i / crateGridSize;
+        int column = i % crateGridSize;
+
+        crateGrid[i].setModel(assetManager.acquireModel("resources/crate/crate.obj"));
+        crateGrid[i].setTexture(assetManager.acquireTexture("resources/crate/diffuse.png"));
+        crateGrid[i].setPosition(9 + row * 1.5f, (column - (crateGridSize - 1) / 2.0f) * 1.5f, 0);
+        crateGrid[i].setOrientation(0, 0, (row * 37 + column * 11) % 90);
+    }
+
+    if(!headless)
+    {
+        SDL_SetWindowRelativeMouseMode(window, true);
+    }
 
     glClearColor(0.04f, 0.23f, 0.51f, 1.0f);
 
@@ -156,19 +301,93 @@ bool init()
     return true;
 }
 
+void writeTrace()
+{
+    if(traceFilename.empty())
+        return;
+
+    if(!Trace::isEnabled())
+    {
+        printf("Tracing was not enabled at compile time, build with TRACING=1\n");
+    }
+    else if(!Trace::writeJson(traceFilename))
+    {
+        printf("Unable to write trace: %s\n", traceFilename.c_str());
+    }
+    else
+    {
+        printf("Wrote trace to %s, %zu events dropped\n", traceFilename.c_str(), Trace::getDroppedEvents());
+    }
+}
+
 void close()
 {
-    crateModel.deleteModel();
-    crateTexture.deleteTexture();
-    mainShader.deleteShader();
+    TRACE_ZONE("close");
+
+    // Let any loads still running finish before their assets are deleted
+    workerPool.stop();
+    assetLoader.processCompleted();
+
+    Entity* entities[] = {&crate1, &crate2, &crate3};
+    for(Entity* entity : entities)
+    {
+        assetManager.releaseModel(entity->getModel());
+        assetManager.releaseTexture(entity->getTexture());
+    }
+    for(Entity& entity : crateGrid)
+    {
+        assetManager.releaseModel(entity.getModel());
+        assetManager.releaseTexture(entity.getTexture());
+    }
+    crateGrid.clear();
+    renderer.deleteRenderer();
+    assetManager.releaseShader(mainShader);
+    assetManager.deleteAll();
+    geometryPool.deletePool();
+    stagingBuffer.deleteBuffer();
+    fileWatcher.stop();
+    framebuffer.deleteFramebuffer();
+    frameRecorder.deleteQueries();
+    gpuProfiler.deleteQueries();
+
+    if(!loadStatisticsFilename.empty() && !LoadStatistics::writeJson(loadStatisticsFilename))
+    {
+        printf("Unable to write load statistics: %s\n", loadStatisticsFilename.c_str());
+    }
 
+    headlessContext.destroy();
     SDL_GL_DestroyContext(context);
     SDL_DestroyWindow(window);
     SDL_Quit();
 }
 
+// Prints the GPU time of each zone in the latest frame the profiler has
+// results for, next to its average over recent frames
+void printGpuProfile()
+{
+    vector<GpuZone> zones = gpuProfiler.getFrameZones();
+    vector<GpuZoneAverage> averages = gpuProfiler.getAverages();
+
+    printf("GPU zones (ms)          last  average\n");
+    for(int i = 0; i < (int) averages.size(); i++)
+    {
+        double last = 0.0;
+        for(int j = 0; j < (int) zones.size(); j++)
+        {
+            if(zones[j].path == averages[i].path)
+                last = zones[j].milliseconds;
+        }
+
+        string label = string(averages[i].depth * 2, ' ') + averages[i].name;
+        printf("  %-20s %7.3f  %7.3f\n", label.c_str(), last, averages[i].milliseconds);
+    }
+    printf("Frames dropped waiting for results: %d\n", gpuProfiler.getDroppedFrames());
+}
+
 void handleEvents()
 {
+    TRACE_ZONE("handleEvents");
+
     SDL_Event event;
     while(SDL_PollEvent(&event))
     {
@@ -183,7 +402,7 @@ void handleEvents()
             windowHeight = event.window.data2;
             glViewport(0, 0, windowWidth, windowHeight);
         }
-        else if(event.type == SDL_EVENT_MOUSE_MOTION)
+        else if(event.type == SDL_EVENT_MOUSE_MOTION && !cameraPath.isLoaded())
         {
             pitch += event.motion.yrel * mouseSensitivity;
             yaw -= event.motion.xrel * mouseSensitivity;
@@ -208,26 +427,62 @@ void handleEvents()
             }
             else if(event.key.key == SDLK_F)
             {
-                isFullscreen = !isFullscreen;
-                SDL_SetWindowFullscreen(window, isFullscreen);
+                // A camera path run keeps the window size it started with,
+                // so every run renders the same number of pixels
+                if(!cameraPath.isLoaded())
+                {
+                    isFullscreen = !isFullscreen;
+                    SDL_SetWindowFullscreen(window, isFullscreen);
+                }
             }
             else if(event.key.key == SDLK_R)
             {
-                if(!mainShader.loadShader())
+                assetManager.reloadAll();
+            }
+            else if(event.key.key == SDLK_G)
+            {
+                printGpuProfile();
+            }
+            else if(event.key.key == SDLK_P)
+            {
+                writeTrace();
+            }
+            else if(event.key.key == SDLK_I)
+            {
+                printf("Triangles drawn: %ld, saved by LOD: %ld, culled: %ld\n", Entity::getTrianglesDrawn(), Entity::getTrianglesSaved(), Entity::getTrianglesCulled());
+                printf("Draw calls: %d, with %d indirect commands for %d instances\n", renderer.getDrawCount(), renderer.getCommandCount(), renderer.getInstanceCount());
+
+                GeometryPoolStatistics poolStatistics = geometryPool.getStatistics();
+                printf("Geometry pool: %d pages, %d allocations, vertices %zu/%zu, index bytes %zu/%zu, fragmentation %.2f/%.2f\n",
+                       poolStatistics.pageCount, poolStatistics.allocationCount,
+                       poolStatistics.verticesUsed, poolStatistics.vertexCapacity,
+                       poolStatistics.indexBytesUsed, poolStatistics.indexCapacity,
+                       poolStatistics.vertexFragmentation, poolStatistics.indexFragmentation);
+
+                LoadRecord loadTotals = LoadStatistics::getTotals();
+                printf("Asset loads: %zu,", LoadStatistics::getRecords().size());
+                for(int phase = 0; phase < LOAD_PHASE_COUNT; phase++)
                 {
-                    printf("Unable to create shader from files: %s\n", mainShader.getFilenames().c_str());
-                    printf("Error message: %s\n", mainShader.getError().c_str());
-                    programRunning = false;
+                    printf(" %s %.1f ms,", LoadStatistics::getPhaseName((LoadPhase) phase), loadTotals.phaseSeconds[phase] * 1000.0);
                 }
-                if(!crateTexture.loadTexture())
+                printf(" %zu bytes read", loadTotals.bytesRead);
+                if(LoadStatistics::isCountingAllocations())
                 {
-                    printf("Unable to load texture: %s\n", crateTexture.getError().c_str());
-                    programRunning = false;
+                    printf(", %zu allocations", loadTotals.allocations);
                 }
-                if(!crateModel.loadOBJModel())
+                printf("\n");
+
+                for(LoadRecord& record : LoadStatistics::getRecords())
                 {
-                    printf("Unable to load model: %s\n", crateModel.getError().c_str());
-                    programRunning = false;
+                    if(record.type != "model" || !record.succeeded)
+                        continue;
+
+                    printf("Vertex memory saved: %zu bytes, max position error %.6f, max normal error %.6f for %s\n",
+                           record.vertexMemorySaved, record.maxPositionError, record.maxNormalError, record.name.c_str());
+                    if(record.acmrBefore > 0.0f)
+                    {
+                        printf("Vertex cache ACMR: %.3f before, %.3f after optimizing %s\n", record.acmrBefore, record.acmrAfter, record.name.c_str());
+                    }
                 }
             }
             else if(event.key.key == SDLK_T)
@@ -242,16 +497,47 @@ void handleEvents()
                     glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
                 }
             }
+            else if(event.key.key == SDLK_N)
+            {
+                showNormals = !showNormals;
+            }
         }
     }
 }
 
 void update()
 {
+    TRACE_ZONE("update");
+
+    stagingBuffer.beginFrame();
+    assetManager.reloadChanged();
+    if(!assetLoader.processCompleted())
+    {
+        printf("Unable to load assets:\n%s\n", assetLoader.getError().c_str());
+    }
+
+    // Frames are measured once every asset has loaded
+    measuringFrame = framesToRender > 0 && assetLoader.getPendingCount() == 0;
+    if(measuringFrame)
+    {
+        frameRecorder.beginFrame();
+    }
+
     Uint64 currentTimestamp = SDL_GetTicks();
     Uint64 timeDelta = currentTimestamp - previousTimestamp;
     previousTimestamp = currentTimestamp;
 
+    if(cameraPath.isLoaded())
+    {
+        CameraKeyframe camera = cameraPath.sample(cameraPath.getStartTime() + framesRendered / cameraPathFrameRate);
+        x = camera.x;
+        y = camera.y;
+        z = camera.z;
+        pitch = camera.pitch;
+        yaw = camera.yaw;
+        return;
+    }
+
     float movementDistance = movementSpeed * timeDelta / 1000;
 
     const bool* keyboardState = SDL_GetKeyboardState(NULL);
@@ -288,9 +574,26 @@ void update()
 
 void draw()
 {
+    TRACE_ZONE("draw");
+
+    gpuProfiler.beginFrame();
+    gpuProfiler.beginZone("frame");
+
+    if(headless)
+    {
+        framebuffer.bind();
+    }
+
+    gpuProfiler.beginZone("clear");
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    gpuProfiler.endZone();
+
+    float fieldOfView = 1.0f;
+    glm::mat4 pMatrix = glm::perspective(fieldOfView, (float) windowWidth / windowHeight, 0.1f, 100.0f);
 
-    glm::mat4 pMatrix = glm::perspective(1.0f, (float) windowWidth / windowHeight, 0.1f, 100.0f);
+    // Pixels covered by one unit at a distance of one unit, used to turn a
+    // model's simplification error into an error on screen
+    float screenScale = windowHeight / (2.0f * tan(fieldOfView / 2.0f));
 
     float yawRadians = yaw * 3.1415 / 180;
     float pitchRadians = pitch * 3.1415 / 180;
@@ -302,25 +605,198 @@ void draw()
     glm::vec3 target = glm::vec3(targetX, targetY, targetZ);
     glm::mat4 vMatrix = glm::lookAt(glm::vec3(x, y, z), target, glm::vec3(0, 0, 1));
 
-    mainShader.bind();
+    Entity::resetStatistics();
 
-    glUniformMatrix4fv(0, 1, GL_FALSE, glm::value_ptr(pMatrix));
-    glUniformMatrix4fv(1, 1, GL_FALSE, glm::value_ptr(vMatrix));
+    if(mainShader->isLoaded())
+    {
+        gpuProfiler.beginZone("entities");
+        mainShader->bind();
 
-    crate1.draw();
-    crate2.draw();
-    crate3.draw();
+        glUniformMatrix4fv(0, 1, GL_FALSE, glm::value_ptr(pMatrix));
+        glUniformMatrix4fv(1, 1, GL_FALSE, glm::value_ptr(vMatrix));
+        glUniform1i(3, showNormals);
 
-    mainShader.unbind();
+        glm::vec3 cameraPosition = glm::vec3(x, y, z);
+        glm::mat4 pvMatrix = pMatrix * vMatrix;
 
-    SDL_GL_SwapWindow(window);
+        renderer.begin(pvMatrix, cameraPosition, screenScale);
+        renderer.submit(&crate1);
+        renderer.submit(&crate2);
+        renderer.submit(&crate3);
+        for(Entity& entity : crateGrid)
+        {
+            renderer.submit(&entity);
+        }
+        renderer.end();
+
+        geometryPool.unbind();
+
+        mainShader->unbind();
+        gpuProfiler.endZone();
+    }
+
+    if(measuringFrame)
+    {
+        frameRecorder.endFrame();
+    }
+
+    // Without a swap to wait on, finishing each frame keeps the frame time
+    // honest and stops the CPU running frames ahead of the GPU
+    if(headless)
+    {
+        gpuProfiler.endFrame();
+        glFinish();
+    }
+    else
+    {
+        gpuProfiler.beginZone("present");
+        SDL_GL_SwapWindow(window);
+        gpuProfiler.endZone();
+        gpuProfiler.endFrame();
+    }
+
+    assetManager.collectGarbage();
+}
+
+// With --frames or a camera path, counts the measured frames and stops
+// after the requested number, reporting their times and saving the last
+// frame if a screenshot was asked for
+void countFrame()
+{
+    if(!measuringFrame)
+        return;
+
+    if(framesRendered == 0)
+    {
+        renderingStart = SDL_GetPerformanceCounter();
+    }
+    framesRendered++;
+
+    if(framesRendered < framesToRender)
+        return;
+
+    double seconds = (double) (SDL_GetPerformanceCounter() - renderingStart) / SDL_GetPerformanceFrequency();
+    printf("Rendered %d frames in %.3f s, %.3f ms per frame\n", framesRendered, seconds, seconds * 1000.0 / framesRendered);
+
+    frameRecorder.finish();
+    FrameTimeSummary cpu = frameRecorder.getCpuSummary();
+    FrameTimeSummary gpu = frameRecorder.getGpuSummary();
+    printf("CPU ms: p50 %.3f, p95 %.3f, p99 %.3f, max %.3f\n", cpu.p50, cpu.p95, cpu.p99, cpu.maximum);
+    printf("GPU ms: p50 %.3f, p95 %.3f, p99 %.3f, max %.3f\n", gpu.p50, gpu.p95, gpu.p99, gpu.maximum);
+    printGpuProfile();
+
+    if(benchmarkOutput.empty() && cameraPath.isLoaded())
+    {
+        benchmarkOutput = "benchmark";
+    }
+    if(!benchmarkOutput.empty())
+    {
+        if(!frameRecorder.writeCsv(benchmarkOutput + ".csv") || !frameRecorder.writeJson(benchmarkOutput + ".json"))
+        {
+            printf("Unable to write frame times to %s\n", benchmarkOutput.c_str());
+        }
+    }
+
+    if(!screenshotFilename.empty())
+    {
+        if(!headless)
+        {
+            printf("Screenshots are only taken in headless mode\n");
+        }
+        else if(!framebuffer.saveScreenshot(screenshotFilename))
+        {
+            printf("%s\n", framebuffer.getError().c_str());
+        }
+    }
+
+    programRunning = false;
 }
 
 int main(int argc, char* argv[])
 {
+    TRACE_THREAD_NAME("main");
+
+    // --load-stats <file> writes the timings of every asset load as JSON
+    // when the program exits. --headless renders without a window, and
+    // --frames <n> exits after n frames, saving the last to --screenshot.
+    // --camera-path <file> flies the camera along a recorded path, writing
+    // frame times to <prefix>.csv and <prefix>.json for --benchmark-output.
+    // --trace <file> writes CPU trace zones as Chrome trace JSON at exit and
+    // whenever P is pressed. --optimize reorders model indices and vertices
+    // for the vertex cache, and I prints the ACMR before and after.
+    // --show-normals starts in the normal view that N toggles.
+    for(int i = 1; i < argc; i++)
+    {
+        string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if(argument == "--load-stats" && hasValue)
+        {
+            loadStatisticsFilename = argv[++i];
+        }
+        else if(argument == "--headless")
+        {
+            headless = true;
+        }
+        else if(argument == "--frames" && hasValue)
+        {
+            framesToRender = atoi(argv[++i]);
+        }
+        else if(argument == "--screenshot" && hasValue)
+        {
+            screenshotFilename = argv[++i];
+        }
+        else if(argument == "--crate-grid" && hasValue)
+        {
+            crateGridSize = atoi(argv[++i]);
+        }
+        else if(argument == "--trace" && hasValue)
+        {
+            traceFilename = argv[++i];
+        }
+        else if(argument == "--camera-path" && hasValue)
+        {
+            cameraPathFilename = argv[++i];
+        }
+        else if(argument == "--benchmark-output" && hasValue)
+        {
+            benchmarkOutput = argv[++i];
+        }
+        else if(argument == "--show-normals")
+        {
+            showNormals = true;
+        }
+        else if(argument == "--optimize")
+        {
+            optimizeModels = true;
+        }
+        else if(argument == "--vertex-layout" && hasValue)
+        {
+            string layout = argv[++i];
+            if(layout == "interleaved")
+            {
+                modelLayout = VERTEX_LAYOUT_INTERLEAVED;
+            }
+            else if(layout == "compressed")
+            {
+                modelLayout = VERTEX_LAYOUT_COMPRESSED;
+            }
+            else
+            {
+                modelLayout = VERTEX_LAYOUT_SEPARATE;
+            }
+        }
+    }
+
+    if(headless && framesToRender <= 0 && cameraPathFilename.empty())
+    {
+        framesToRender = 1;
+    }
+
     if(!init())
     {
         close();
+        writeTrace();
         return -1;
     }
 
@@ -328,10 +804,12 @@ int main(int argc, char* argv[])
     {
         update();
         draw();
+        countFrame();
         handleEvents();
     }
 
     close();
+    writeTrace();
 
     return 0;
 }
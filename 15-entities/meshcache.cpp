@@ -0,0 +1,279 @@
+#include "meshcache.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+static const char cacheMagic[8] = {'G', 'B', 'M', 'E', 'S', 'H', 0, 0};
+static const uint32_t cacheVersion = 7;
+static const uint64_t sectionAlignment = 64;
+
+MeshCache::MeshCache()
+{
+    header = NULL;
+    sectionTable = NULL;
+}
+
+uint64_t MeshCache::hashData(const char* data, size_t length)
+{
+    // 64-bit FNV-1a, only used to tell whether a touched source file
+    // actually changed
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for(size_t i = 0; i < length; i++)
+    {
+        hash ^= (unsigned char) data[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+bool MeshCache::getSourceStatus(string sourceFilename, uint64_t& size, int64_t& modifiedTime)
+{
+    error_code error;
+    size = filesystem::file_size(sourceFilename, error);
+    if(error)
+        return false;
+
+    filesystem::file_time_type writeTime = filesystem::last_write_time(sourceFilename, error);
+    if(error)
+        return false;
+
+    modifiedTime = writeTime.time_since_epoch().count();
+    return true;
+}
+
+bool MeshCache::open(string cacheFilename, string sourceFilename, uint32_t settings)
+{
+    close();
+    errorMessage = "";
+
+    if(!file.open(cacheFilename))
+    {
+        errorMessage = file.getError();
+        return false;
+    }
+
+    if(file.getSize() < sizeof(Header))
+    {
+        errorMessage = "Mesh cache is truncated: " + cacheFilename;
+        close();
+        return false;
+    }
+
+    header = (const Header*) file.getData();
+    if(memcmp(header->magic, cacheMagic, sizeof(cacheMagic)) != 0 || header->version != cacheVersion)
+    {
+        errorMessage = "Mesh cache has an unknown format: " + cacheFilename;
+        close();
+        return false;
+    }
+
+    uint64_t tableEnd = sizeof(Header) + (uint64_t) header->sectionCount * sizeof(SectionEntry);
+    if(tableEnd > file.getSize())
+    {
+        errorMessage = "Mesh cache is truncated: " + cacheFilename;
+        close();
+        return false;
+    }
+
+    sectionTable = (const SectionEntry*) (file.getData() + sizeof(Header));
+    for(uint32_t i = 0; i < header->sectionCount; i++)
+    {
+        if(sectionTable[i].offset > file.getSize() || sectionTable[i].size > file.getSize() - sectionTable[i].offset)
+        {
+            errorMessage = "Mesh cache is truncated: " + cacheFilename;
+            close();
+            return false;
+        }
+    }
+
+    // The cache stores buffers already laid out for the model's load
+    // settings, so different settings need a fresh bake
+    if(header->settings != settings)
+    {
+        errorMessage = "Mesh cache was built with different settings: " + cacheFilename;
+        close();
+        return false;
+    }
+
+    uint64_t sourceSize;
+    int64_t sourceModifiedTime;
+    if(!getSourceStatus(sourceFilename, sourceSize, sourceModifiedTime) || sourceSize != header->sourceSize)
+    {
+        errorMessage = "Mesh cache is out of date: " + cacheFilename;
+        close();
+        return false;
+    }
+
+    // A different timestamp alone (e.g. after a fresh checkout) does not
+    // invalidate the cache if the contents still hash the same
+    if(sourceModifiedTime != header->sourceModifiedTime)
+    {
+        FileView source;
+        if(!source.open(sourceFilename) || hashData(source.getData(), source.getSize()) != header->sourceHash)
+        {
+            errorMessage = "Mesh cache is out of date: " + cacheFilename;
+            close();
+            return false;
+        }
+
+        refreshModifiedTime(cacheFilename, sourceModifiedTime);
+    }
+
+    return true;
+}
+
+// Stores the source's new timestamp once its contents hashed the same, so
+// later loads skip the hash. A failure only means hashing again next time.
+void MeshCache::refreshModifiedTime(string cacheFilename, int64_t modifiedTime)
+{
+    Header newHeader = *header;
+    newHeader.sourceModifiedTime = modifiedTime;
+
+    string temporaryFilename = cacheFilename + ".tmp";
+    ofstream stream(temporaryFilename, ios::binary | ios::trunc);
+    if(!stream)
+        return;
+
+    stream.write((const char*) &newHeader, sizeof(newHeader));
+    stream.write(file.getData() + sizeof(Header), file.getSize() - sizeof(Header));
+
+    // The rename leaves this mapping of the old file valid where the
+    // platform allows it at all
+    error_code error;
+    stream.close();
+    if(!stream)
+    {
+        filesystem::remove(temporaryFilename, error);
+        return;
+    }
+
+    filesystem::rename(temporaryFilename, cacheFilename, error);
+    if(error)
+    {
+        filesystem::remove(temporaryFilename, error);
+    }
+}
+
+bool MeshCache::write(string cacheFilename, string sourceFilename, uint32_t settings, FileView& source, vector<MeshCacheSection>& sections, glm::vec3 boundsMin, glm::vec3 boundsMax)
+{
+    Header newHeader;
+    memset(&newHeader, 0, sizeof(newHeader));
+    memcpy(newHeader.magic, cacheMagic, sizeof(cacheMagic));
+    newHeader.version = cacheVersion;
+    newHeader.sectionCount = sections.size();
+    newHeader.settings = settings;
+    newHeader.sourceHash = hashData(source.getData(), source.getSize());
+    for(int i = 0; i < 3; i++)
+    {
+        newHeader.boundsMin[i] = boundsMin[i];
+        newHeader.boundsMax[i] = boundsMax[i];
+    }
+
+    if(!getSourceStatus(sourceFilename, newHeader.sourceSize, newHeader.sourceModifiedTime))
+    {
+        errorMessage = "Cannot read source file status: " + sourceFilename;
+        return false;
+    }
+
+    vector<SectionEntry> entries(sections.size());
+    uint64_t offset = sizeof(Header) + sections.size() * sizeof(SectionEntry);
+    for(int i = 0; i < (int) sections.size(); i++)
+    {
+        offset = (offset + sectionAlignment - 1) & ~(sectionAlignment - 1);
+
+        entries[i].type = sections[i].type;
+        entries[i].reserved = 0;
+        entries[i].offset = offset;
+        entries[i].size = sections[i].size;
+
+        offset += sections[i].size;
+    }
+
+    // Write to a temporary file and rename it into place, so a reader never
+    // maps a half-written cache
+    string temporaryFilename = cacheFilename + ".tmp";
+    ofstream stream(temporaryFilename, ios::binary | ios::trunc);
+    if(!stream)
+    {
+        errorMessage = "Cannot create mesh cache: " + cacheFilename;
+        return false;
+    }
+
+    stream.write((const char*) &newHeader, sizeof(newHeader));
+    stream.write((const char*) entries.data(), entries.size() * sizeof(SectionEntry));
+
+    const char padding[sectionAlignment] = {0};
+    uint64_t position = sizeof(Header) + sections.size() * sizeof(SectionEntry);
+    for(int i = 0; i < (int) sections.size(); i++)
+    {
+        stream.write(padding, entries[i].offset - position);
+        stream.write((const char*) sections[i].data, sections[i].size);
+        position = entries[i].offset + sections[i].size;
+    }
+
+    error_code error;
+    stream.close();
+    if(!stream)
+    {
+        errorMessage = "Cannot write mesh cache: " + cacheFilename;
+        filesystem::remove(temporaryFilename, error);
+        return false;
+    }
+
+    filesystem::rename(temporaryFilename, cacheFilename, error);
+    if(error)
+    {
+        errorMessage = "Cannot write mesh cache: " + cacheFilename;
+        filesystem::remove(temporaryFilename, error);
+        return false;
+    }
+
+    return true;
+}
+
+void MeshCache::close()
+{
+    file.close();
+    header = NULL;
+    sectionTable = NULL;
+}
+
+const void* MeshCache::getSectionData(uint32_t type)
+{
+    for(uint32_t i = 0; header != NULL && i < header->sectionCount; i++)
+    {
+        if(sectionTable[i].type == type)
+        {
+            return file.getData() + sectionTable[i].offset;
+        }
+    }
+    return NULL;
+}
+
+uint64_t MeshCache::getSectionSize(uint32_t type)
+{
+    for(uint32_t i = 0; header != NULL && i < header->sectionCount; i++)
+    {
+        if(sectionTable[i].type == type)
+        {
+            return sectionTable[i].size;
+        }
+    }
+    return 0;
+}
+
+glm::vec3 MeshCache::getBoundsMin()
+{
+    return glm::vec3(header->boundsMin[0], header->boundsMin[1], header->boundsMin[2]);
+}
+
+glm::vec3 MeshCache::getBoundsMax()
+{
+    return glm::vec3(header->boundsMax[0], header->boundsMax[1], header->boundsMax[2]);
+}
+
+string MeshCache::getError()
+{
+    return errorMessage;
+}
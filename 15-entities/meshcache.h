@@ -0,0 +1,81 @@
+#pragma once
+
+#include "fileview.h"
+
+#include <glm/glm.hpp>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+enum MeshCacheSectionType
+{
+    MESH_CACHE_VERTEX_BUFFER_0 = 1,
+    MESH_CACHE_VERTEX_BUFFER_1,
+    MESH_CACHE_VERTEX_BUFFER_2,
+    MESH_CACHE_INDICES,
+    MESH_CACHE_QUANTIZATION,
+    MESH_CACHE_OPTIMIZATION,
+    MESH_CACHE_LODS,
+    MESH_CACHE_MESHLETS
+};
+
+struct MeshCacheSection
+{
+    uint32_t type;
+    const void* data;
+    uint64_t size;
+};
+
+class MeshCache
+{
+    public:
+        MeshCache();
+
+        bool open(string cacheFilename, string sourceFilename, uint32_t settings);
+        bool write(string cacheFilename, string sourceFilename, uint32_t settings, FileView& source, vector<MeshCacheSection>& sections, glm::vec3 boundsMin, glm::vec3 boundsMax);
+        void close();
+
+        const void* getSectionData(uint32_t type);
+        uint64_t getSectionSize(uint32_t type);
+
+        glm::vec3 getBoundsMin();
+        glm::vec3 getBoundsMax();
+
+        string getError();
+
+    private:
+        struct Header
+        {
+            char magic[8];
+            uint32_t version;
+            uint32_t sectionCount;
+            uint32_t settings;
+            uint32_t reserved;
+            uint64_t sourceSize;
+            int64_t sourceModifiedTime;
+            uint64_t sourceHash;
+            float boundsMin[3];
+            float boundsMax[3];
+        };
+
+        struct SectionEntry
+        {
+            uint32_t type;
+            uint32_t reserved;
+            uint64_t offset;
+            uint64_t size;
+        };
+
+        FileView file;
+        const Header* header;
+        const SectionEntry* sectionTable;
+
+        string errorMessage;
+
+        void refreshModifiedTime(string cacheFilename, int64_t modifiedTime);
+
+        static uint64_t hashData(const char* data, size_t length);
+        static bool getSourceStatus(string sourceFilename, uint64_t& size, int64_t& modifiedTime);
+};
@@ -0,0 +1,206 @@
+#include "meshletbuilder.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Groups triangles into small clusters that can be culled on their own.
+// Triangles are reordered so each meshlet is one contiguous index range.
+void MeshletBuilder::build(vector<GLuint>& indices, vector<GLfloat>& vertices, vector<Meshlet>& meshlets)
+{
+    meshlets.clear();
+
+    size_t vertexCount = vertices.size() / 3;
+    size_t triangleCount = indices.size() / 3;
+    if(triangleCount == 0)
+        return;
+
+    vector<int> liveTriangles(vertexCount, 0);
+    for(size_t i = 0; i < indices.size(); i++)
+    {
+        liveTriangles[indices[i]]++;
+    }
+
+    vector<size_t> adjacencyOffsets(vertexCount + 1, 0);
+    for(size_t vertex = 0; vertex < vertexCount; vertex++)
+    {
+        adjacencyOffsets[vertex + 1] = adjacencyOffsets[vertex] + liveTriangles[vertex];
+    }
+
+    vector<GLuint> adjacency(indices.size());
+    vector<size_t> adjacencyFill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for(size_t triangle = 0; triangle < triangleCount; triangle++)
+    {
+        for(int corner = 0; corner < 3; corner++)
+        {
+            adjacency[adjacencyFill[indices[triangle * 3 + corner]]++] = triangle;
+        }
+    }
+
+    // Which meshlet each vertex was last added to, so membership of the
+    // current meshlet is a single comparison
+    vector<long> vertexMeshlet(vertexCount, -1);
+    vector<char> triangleAdded(triangleCount, 0);
+
+    vector<GLuint> output;
+    output.reserve(indices.size());
+
+    vector<GLuint> meshletVertices;
+    meshletVertices.reserve(maxVertices);
+
+    Meshlet current = Meshlet();
+    size_t nextUnadded = 0;
+
+    while(output.size() < indices.size())
+    {
+        long meshletIndex = meshlets.size();
+
+        // Prefer the triangle touching the meshlet that needs the fewest new
+        // vertices, which keeps clusters compact rather than strip-shaped
+        long bestTriangle = -1;
+        int bestNewVertices = 4;
+        for(size_t i = 0; i < meshletVertices.size() && bestNewVertices > 0; i++)
+        {
+            GLuint vertex = meshletVertices[i];
+            size_t begin = adjacencyOffsets[vertex];
+            size_t end = begin + liveTriangles[vertex];
+            for(size_t j = begin; j < end; j++)
+            {
+                GLuint triangle = adjacency[j];
+                int newVertices = 0;
+                for(int corner = 0; corner < 3; corner++)
+                {
+                    newVertices += vertexMeshlet[indices[triangle * 3 + corner]] != meshletIndex;
+                }
+
+                if(newVertices < bestNewVertices)
+                {
+                    bestNewVertices = newVertices;
+                    bestTriangle = triangle;
+                }
+            }
+        }
+
+        // Otherwise continue with the next triangle in the original order
+        if(bestTriangle < 0)
+        {
+            while(triangleAdded[nextUnadded])
+            {
+                nextUnadded++;
+            }
+            bestTriangle = nextUnadded;
+            bestNewVertices = 0;
+            for(int corner = 0; corner < 3; corner++)
+            {
+                bestNewVertices += vertexMeshlet[indices[bestTriangle * 3 + corner]] != meshletIndex;
+            }
+        }
+
+        bool full = meshletVertices.size() + bestNewVertices > maxVertices ||
+                    current.indexCount / 3 + 1 > maxTriangles;
+        if(full)
+        {
+            calculateBounds(output, vertices, current);
+            meshlets.push_back(current);
+
+            current = Meshlet();
+            current.firstIndex = output.size();
+            meshletVertices.clear();
+            meshletIndex++;
+        }
+
+        triangleAdded[bestTriangle] = 1;
+
+        for(int corner = 0; corner < 3; corner++)
+        {
+            GLuint vertex = indices[bestTriangle * 3 + corner];
+            output.push_back(vertex);
+
+            if(vertexMeshlet[vertex] != meshletIndex)
+            {
+                vertexMeshlet[vertex] = meshletIndex;
+                meshletVertices.push_back(vertex);
+            }
+
+            size_t begin = adjacencyOffsets[vertex];
+            size_t end = begin + liveTriangles[vertex];
+            for(size_t i = begin; i < end; i++)
+            {
+                if(adjacency[i] == (GLuint) bestTriangle)
+                {
+                    adjacency[i] = adjacency[end - 1];
+                    break;
+                }
+            }
+            liveTriangles[vertex]--;
+        }
+        current.indexCount += 3;
+    }
+
+    calculateBounds(output, vertices, current);
+    meshlets.push_back(current);
+
+    indices.swap(output);
+}
+
+void MeshletBuilder::calculateBounds(vector<GLuint>& indices, vector<GLfloat>& vertices, Meshlet& meshlet)
+{
+    GLuint* triangles = &indices[meshlet.firstIndex];
+
+    glm::vec3 low = glm::vec3(vertices[triangles[0] * 3], vertices[triangles[0] * 3 + 1], vertices[triangles[0] * 3 + 2]);
+    glm::vec3 high = low;
+    glm::vec3 normalSum = glm::vec3(0.0f);
+    vector<glm::vec3> normals;
+    normals.reserve(meshlet.indexCount / 3);
+
+    for(GLuint i = 0; i < meshlet.indexCount; i += 3)
+    {
+        glm::vec3 corners[3];
+        for(int corner = 0; corner < 3; corner++)
+        {
+            GLfloat* position = &vertices[triangles[i + corner] * 3];
+            corners[corner] = glm::vec3(position[0], position[1], position[2]);
+            low = glm::min(low, corners[corner]);
+            high = glm::max(high, corners[corner]);
+        }
+
+        glm::vec3 normal = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+        float length = glm::length(normal);
+        if(length > 0.0f)
+        {
+            normal = normal / length;
+            normals.push_back(normal);
+            normalSum += normal;
+        }
+    }
+
+    meshlet.center = (low + high) * 0.5f;
+    meshlet.radius = 0.0f;
+    for(GLuint i = 0; i < meshlet.indexCount; i++)
+    {
+        GLfloat* position = &vertices[triangles[i] * 3];
+        glm::vec3 offset = glm::vec3(position[0], position[1], position[2]) - meshlet.center;
+        meshlet.radius = max(meshlet.radius, glm::length(offset));
+    }
+
+    // The cone holds every triangle normal in the cluster. Clusters whose
+    // normals spread too far apart get a cutoff that never culls.
+    meshlet.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+    meshlet.coneCutoff = 1.0f;
+
+    float axisLength = glm::length(normalSum);
+    if(axisLength == 0.0f)
+        return;
+
+    glm::vec3 axis = normalSum / axisLength;
+    float minimumDot = 1.0f;
+    for(size_t i = 0; i < normals.size(); i++)
+    {
+        minimumDot = min(minimumDot, glm::dot(normals[i], axis));
+    }
+
+    meshlet.coneAxis = axis;
+    if(minimumDot > 0.1f)
+    {
+        meshlet.coneCutoff = sqrtf(1.0f - minimumDot * minimumDot);
+    }
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+using namespace std;
+
+struct Meshlet
+{
+    GLuint firstIndex;
+    GLuint indexCount;
+
+    glm::vec3 center;
+    float radius;
+
+    glm::vec3 coneAxis;
+    float coneCutoff;
+};
+
+class MeshletBuilder
+{
+    public:
+        static const int maxVertices = 64;
+        static const int maxTriangles = 124;
+
+        static void build(vector<GLuint>& indices, vector<GLfloat>& vertices, vector<Meshlet>& meshlets);
+
+    private:
+        static void calculateBounds(vector<GLuint>& indices, vector<GLfloat>& vertices, Meshlet& meshlet);
+};
@@ -0,0 +1,243 @@
+#include "meshoptimizer.h"
+#include "model.h"
+
+#include <cmath>
+
+// Scoring parameters from Tom Forsyth's "Linear-Speed Vertex Cache
+// Optimisation", simulating an LRU cache of this size
+static const int optimizerCacheSize = 32;
+static const float cacheDecayPower = 1.5f;
+static const float lastTriangleScore = 0.75f;
+static const float valenceBoostScale = 2.0f;
+static const float valenceBoostPower = 0.5f;
+
+static float scoreVertex(int cachePosition, int liveTriangles)
+{
+    if(liveTriangles == 0)
+        return -1.0f;
+
+    float score = 0.0f;
+    if(cachePosition >= 0)
+    {
+        if(cachePosition < 3)
+        {
+            // The triangle just drawn is penalised slightly so that the
+            // next one does not reuse exactly the same edge every time
+            score = lastTriangleScore;
+        }
+        else
+        {
+            float scaler = 1.0f / (optimizerCacheSize - 3);
+            score = powf(1.0f - (cachePosition - 3) * scaler, cacheDecayPower);
+        }
+    }
+
+    score += valenceBoostScale * powf((float) liveTriangles, -valenceBoostPower);
+    return score;
+}
+
+void MeshOptimizer::optimizeVertexCache(vector<GLuint>& indices, size_t vertexCount)
+{
+    size_t triangleCount = indices.size() / 3;
+    if(triangleCount == 0)
+        return;
+
+    // Adjacency from each vertex to the triangles that still use it
+    vector<int> liveTriangles(vertexCount, 0);
+    for(size_t i = 0; i < indices.size(); i++)
+    {
+        liveTriangles[indices[i]]++;
+    }
+
+    vector<size_t> adjacencyOffsets(vertexCount + 1, 0);
+    for(size_t vertex = 0; vertex < vertexCount; vertex++)
+    {
+        adjacencyOffsets[vertex + 1] = adjacencyOffsets[vertex] + liveTriangles[vertex];
+    }
+
+    vector<GLuint> adjacency(indices.size());
+    vector<size_t> adjacencyFill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for(size_t triangle = 0; triangle < triangleCount; triangle++)
+    {
+        for(int corner = 0; corner < 3; corner++)
+        {
+            GLuint vertex = indices[triangle * 3 + corner];
+            adjacency[adjacencyFill[vertex]++] = triangle;
+        }
+    }
+
+    vector<float> vertexScores(vertexCount);
+    for(size_t vertex = 0; vertex < vertexCount; vertex++)
+    {
+        vertexScores[vertex] = scoreVertex(-1, liveTriangles[vertex]);
+    }
+
+    vector<char> triangleAdded(triangleCount, 0);
+
+    vector<GLuint> output;
+    output.reserve(indices.size());
+
+    vector<GLuint> cache;
+    vector<GLuint> newCache;
+    cache.reserve(optimizerCacheSize + 3);
+    newCache.reserve(optimizerCacheSize + 3);
+
+    size_t nextUnadded = 0;
+    long bestTriangle = -1;
+
+    while(output.size() < indices.size())
+    {
+        // With no good candidate from the cache, continue with the next
+        // triangle in the original order
+        if(bestTriangle < 0)
+        {
+            while(triangleAdded[nextUnadded])
+            {
+                nextUnadded++;
+            }
+            bestTriangle = nextUnadded;
+        }
+
+        triangleAdded[bestTriangle] = 1;
+
+        newCache.clear();
+        for(int corner = 0; corner < 3; corner++)
+        {
+            GLuint vertex = indices[bestTriangle * 3 + corner];
+            output.push_back(vertex);
+            newCache.push_back(vertex);
+
+            // Remove the triangle from the vertex's live adjacency list
+            size_t begin = adjacencyOffsets[vertex];
+            size_t end = begin + liveTriangles[vertex];
+            for(size_t i = begin; i < end; i++)
+            {
+                if(adjacency[i] == (GLuint) bestTriangle)
+                {
+                    adjacency[i] = adjacency[end - 1];
+                    break;
+                }
+            }
+            liveTriangles[vertex]--;
+        }
+
+        for(int i = 0; i < (int) cache.size(); i++)
+        {
+            GLuint vertex = cache[i];
+            if(vertex != newCache[0] && vertex != newCache[1] && vertex != newCache[2])
+            {
+                newCache.push_back(vertex);
+            }
+        }
+
+        for(int i = optimizerCacheSize; i < (int) newCache.size(); i++)
+        {
+            vertexScores[newCache[i]] = scoreVertex(-1, liveTriangles[newCache[i]]);
+        }
+
+        if((int) newCache.size() > optimizerCacheSize)
+        {
+            newCache.resize(optimizerCacheSize);
+        }
+        cache.swap(newCache);
+
+        // Rescore the cached vertices and every live triangle that touches
+        // them, remembering the best one as the next triangle to emit
+        for(int i = 0; i < (int) cache.size(); i++)
+        {
+            vertexScores[cache[i]] = scoreVertex(i, liveTriangles[cache[i]]);
+        }
+
+        bestTriangle = -1;
+        float bestScore = -1.0f;
+        for(int i = 0; i < (int) cache.size(); i++)
+        {
+            GLuint vertex = cache[i];
+            size_t begin = adjacencyOffsets[vertex];
+            size_t end = begin + liveTriangles[vertex];
+            for(size_t j = begin; j < end; j++)
+            {
+                GLuint triangle = adjacency[j];
+                float score = vertexScores[indices[triangle * 3]] +
+                              vertexScores[indices[triangle * 3 + 1]] +
+                              vertexScores[indices[triangle * 3 + 2]];
+
+                if(score > bestScore)
+                {
+                    bestScore = score;
+                    bestTriangle = triangle;
+                }
+            }
+        }
+    }
+
+    indices.swap(output);
+}
+
+void MeshOptimizer::optimizeVertexFetch(MeshData& mesh)
+{
+    // Renumber vertices in order of first use so that the vertex fetches
+    // for consecutive triangles walk through memory linearly
+    size_t vertexCount = mesh.vertices.size() / 3;
+    const GLuint unassigned = 0xffffffff;
+
+    vector<GLuint> remap(vertexCount, unassigned);
+    GLuint nextVertex = 0;
+    for(size_t i = 0; i < mesh.indices.size(); i++)
+    {
+        GLuint& index = mesh.indices[i];
+        if(remap[index] == unassigned)
+        {
+            remap[index] = nextVertex++;
+        }
+        index = remap[index];
+    }
+
+    vector<GLfloat> vertices(nextVertex * 3);
+    vector<GLfloat> normals(nextVertex * 3);
+    vector<GLfloat> textureCoordinates(nextVertex * 2);
+    for(size_t vertex = 0; vertex < vertexCount; vertex++)
+    {
+        GLuint target = remap[vertex];
+        if(target == unassigned)
+            continue;
+
+        for(int i = 0; i < 3; i++)
+        {
+            vertices[target * 3 + i] = mesh.vertices[vertex * 3 + i];
+            normals[target * 3 + i] = mesh.normals[vertex * 3 + i];
+        }
+        textureCoordinates[target * 2 + 0] = mesh.textureCoordinates[vertex * 2 + 0];
+        textureCoordinates[target * 2 + 1] = mesh.textureCoordinates[vertex * 2 + 1];
+    }
+
+    mesh.vertices.swap(vertices);
+    mesh.normals.swap(normals);
+    mesh.textureCoordinates.swap(textureCoordinates);
+}
+
+float MeshOptimizer::calculateACMR(vector<GLuint>& indices, size_t vertexCount, int cacheSize)
+{
+    // Simulates a FIFO post-transform cache and returns the average number
+    // of vertex shader invocations per triangle
+    size_t triangleCount = indices.size() / 3;
+    if(triangleCount == 0)
+        return 0.0f;
+
+    vector<size_t> insertedAt(vertexCount, 0);
+    size_t timestamp = cacheSize + 1;
+    size_t misses = 0;
+
+    for(size_t i = 0; i < indices.size(); i++)
+    {
+        GLuint vertex = indices[i];
+        if(timestamp - insertedAt[vertex] > (size_t) cacheSize)
+        {
+            insertedAt[vertex] = timestamp;
+            timestamp++;
+            misses++;
+        }
+    }
+
+    return (float) misses / triangleCount;
+}
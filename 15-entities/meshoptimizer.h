@@ -0,0 +1,17 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <vector>
+
+using namespace std;
+
+struct MeshData;
+
+class MeshOptimizer
+{
+    public:
+        static void optimizeVertexCache(vector<GLuint>& indices, size_t vertexCount);
+        static void optimizeVertexFetch(MeshData& mesh);
+
+        static float calculateACMR(vector<GLuint>& indices, size_t vertexCount, int cacheSize = 16);
+};
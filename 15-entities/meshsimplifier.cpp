@@ -0,0 +1,316 @@
+#include "meshsimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+void MeshSimplifier::addPlane(Quadric& quadric, double normal[3], double distance, double weight)
+{
+    double a = normal[0], b = normal[1], c = normal[2], d = distance;
+
+    quadric.a00 += weight * a * a;
+    quadric.a01 += weight * a * b;
+    quadric.a02 += weight * a * c;
+    quadric.a03 += weight * a * d;
+    quadric.a11 += weight * b * b;
+    quadric.a12 += weight * b * c;
+    quadric.a13 += weight * b * d;
+    quadric.a22 += weight * c * c;
+    quadric.a23 += weight * c * d;
+    quadric.a33 += weight * d * d;
+    quadric.weight += weight;
+}
+
+void MeshSimplifier::addQuadric(Quadric& quadric, const Quadric& other)
+{
+    quadric.a00 += other.a00;
+    quadric.a01 += other.a01;
+    quadric.a02 += other.a02;
+    quadric.a03 += other.a03;
+    quadric.a11 += other.a11;
+    quadric.a12 += other.a12;
+    quadric.a13 += other.a13;
+    quadric.a22 += other.a22;
+    quadric.a23 += other.a23;
+    quadric.a33 += other.a33;
+    quadric.weight += other.weight;
+}
+
+double MeshSimplifier::evaluate(const Quadric& quadric, const float* position)
+{
+    double x = position[0], y = position[1], z = position[2];
+
+    return quadric.a00 * x * x + 2 * quadric.a01 * x * y + 2 * quadric.a02 * x * z + 2 * quadric.a03 * x +
+           quadric.a11 * y * y + 2 * quadric.a12 * y * z + 2 * quadric.a13 * y +
+           quadric.a22 * z * z + 2 * quadric.a23 * z +
+           quadric.a33;
+}
+
+// Area-weighted mean squared distance to the planes of the collapsed
+// triangles
+double MeshSimplifier::collapseError(const Quadric& quadric, const float* position)
+{
+    if(quadric.weight <= 0.0)
+        return 0.0;
+
+    return max(evaluate(quadric, position), 0.0) / quadric.weight;
+}
+
+static void triangleNormal(const float* a, const float* b, const float* c, double* normal)
+{
+    double ab[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+    double ac[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+
+    normal[0] = ab[1] * ac[2] - ab[2] * ac[1];
+    normal[1] = ab[2] * ac[0] - ab[0] * ac[2];
+    normal[2] = ab[0] * ac[1] - ab[1] * ac[0];
+}
+
+// Collapses edges by moving one endpoint onto the other, so every level of
+// detail can index the original vertex buffer. Returns the error of the
+// worst collapse as a fraction of the mesh extent.
+float MeshSimplifier::simplify(vector<GLuint>& indices, vector<GLfloat>& vertices, size_t targetIndexCount, float maxError, vector<GLuint>& result)
+{
+    size_t vertexCount = vertices.size() / 3;
+    result = indices;
+
+    if(result.size() <= targetIndexCount || vertexCount == 0)
+        return 0.0f;
+
+    // Work in a unit-sized space so errors are independent of mesh scale
+    float low[3] = {vertices[0], vertices[1], vertices[2]};
+    float high[3] = {vertices[0], vertices[1], vertices[2]};
+    for(size_t i = 0; i < vertices.size(); i += 3)
+    {
+        for(int axis = 0; axis < 3; axis++)
+        {
+            low[axis] = min(low[axis], vertices[i + axis]);
+            high[axis] = max(high[axis], vertices[i + axis]);
+        }
+    }
+
+    float extent = max(high[0] - low[0], max(high[1] - low[1], high[2] - low[2]));
+    float scale = extent > 0.0f ? 1.0f / extent : 1.0f;
+
+    vector<float> positions(vertices.size());
+    for(size_t i = 0; i < vertices.size(); i += 3)
+    {
+        for(int axis = 0; axis < 3; axis++)
+        {
+            positions[i + axis] = (vertices[i + axis] - low[axis]) * scale;
+        }
+    }
+
+    vector<Quadric> quadrics(vertexCount);
+    memset(quadrics.data(), 0, quadrics.size() * sizeof(Quadric));
+
+    for(size_t i = 0; i < result.size(); i += 3)
+    {
+        const float* a = &positions[result[i] * 3];
+        const float* b = &positions[result[i + 1] * 3];
+        const float* c = &positions[result[i + 2] * 3];
+
+        double normal[3];
+        triangleNormal(a, b, c, normal);
+
+        double length = sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        if(length == 0.0)
+            continue;
+
+        normal[0] /= length;
+        normal[1] /= length;
+        normal[2] /= length;
+
+        double distance = -(normal[0] * a[0] + normal[1] * a[1] + normal[2] * a[2]);
+        double area = length * 0.5;
+
+        for(int corner = 0; corner < 3; corner++)
+        {
+            addPlane(quadrics[result[i + corner]], normal, distance, area);
+        }
+    }
+
+    // Vertices on open edges are locked. Attribute seams are open edges too,
+    // because the loader splits vertices wherever the normal or texture
+    // coordinate changes, so this also keeps textures from tearing.
+    unordered_map<uint64_t, int> edgeUses;
+    edgeUses.reserve(result.size());
+    for(size_t i = 0; i < result.size(); i += 3)
+    {
+        for(int corner = 0; corner < 3; corner++)
+        {
+            uint64_t a = result[i + corner];
+            uint64_t b = result[i + (corner + 1) % 3];
+            edgeUses[a < b ? (a << 32) | b : (b << 32) | a]++;
+        }
+    }
+
+    vector<char> locked(vertexCount, 0);
+    for(auto& edge : edgeUses)
+    {
+        if(edge.second == 1)
+        {
+            locked[edge.first >> 32] = 1;
+            locked[edge.first & 0xffffffff] = 1;
+        }
+    }
+    edgeUses.clear();
+
+    double maxCost = (double) maxError * maxError;
+    double worstCost = 0.0;
+
+    vector<size_t> adjacencyOffsets(vertexCount + 1);
+    vector<GLuint> adjacency;
+    vector<Collapse> collapses;
+    vector<GLuint> collapseTarget(vertexCount);
+    vector<char> touched(vertexCount);
+
+    while(result.size() > targetIndexCount)
+    {
+        size_t triangleCount = result.size() / 3;
+
+        fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+        for(size_t i = 0; i < result.size(); i++)
+        {
+            adjacencyOffsets[result[i] + 1]++;
+        }
+        for(size_t vertex = 0; vertex < vertexCount; vertex++)
+        {
+            adjacencyOffsets[vertex + 1] += adjacencyOffsets[vertex];
+        }
+
+        adjacency.resize(result.size());
+        vector<size_t> adjacencyFill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for(size_t triangle = 0; triangle < triangleCount; triangle++)
+        {
+            for(int corner = 0; corner < 3; corner++)
+            {
+                adjacency[adjacencyFill[result[triangle * 3 + corner]]++] = triangle;
+            }
+        }
+
+        collapses.clear();
+        for(size_t i = 0; i < result.size(); i += 3)
+        {
+            for(int corner = 0; corner < 3; corner++)
+            {
+                GLuint a = result[i + corner];
+                GLuint b = result[i + (corner + 1) % 3];
+
+                Quadric combined = quadrics[a];
+                addQuadric(combined, quadrics[b]);
+
+                if(!locked[a])
+                {
+                    Collapse collapse = {a, b, (float) collapseError(combined, &positions[b * 3])};
+                    collapses.push_back(collapse);
+                }
+                if(!locked[b])
+                {
+                    Collapse collapse = {b, a, (float) collapseError(combined, &positions[a * 3])};
+                    collapses.push_back(collapse);
+                }
+            }
+        }
+
+        sort(collapses.begin(), collapses.end(), [](const Collapse& first, const Collapse& second)
+        {
+            return first.cost < second.cost;
+        });
+
+        for(size_t vertex = 0; vertex < vertexCount; vertex++)
+        {
+            collapseTarget[vertex] = vertex;
+        }
+        fill(touched.begin(), touched.end(), 0);
+
+        size_t trianglesToRemove = (result.size() - targetIndexCount) / 3;
+        size_t trianglesRemoved = 0;
+        size_t collapsesApplied = 0;
+
+        for(size_t i = 0; i < collapses.size() && trianglesRemoved < trianglesToRemove; i++)
+        {
+            Collapse& collapse = collapses[i];
+            if(collapse.cost > maxCost)
+                break;
+
+            if(touched[collapse.from] || touched[collapse.to])
+                continue;
+
+            // Reject collapses that would flip any of the remaining triangles
+            // around the moved vertex
+            bool flips = false;
+            size_t removed = 0;
+            for(size_t j = adjacencyOffsets[collapse.from]; j < adjacencyOffsets[collapse.from + 1] && !flips; j++)
+            {
+                GLuint* triangle = &result[adjacency[j] * 3];
+                if(triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+                {
+                    removed++;
+                    continue;
+                }
+
+                const float* corners[3];
+                const float* moved[3];
+                for(int corner = 0; corner < 3; corner++)
+                {
+                    corners[corner] = &positions[triangle[corner] * 3];
+                    moved[corner] = triangle[corner] == collapse.from ? &positions[collapse.to * 3] : corners[corner];
+                }
+
+                double before[3], after[3];
+                triangleNormal(corners[0], corners[1], corners[2], before);
+                triangleNormal(moved[0], moved[1], moved[2], after);
+                flips = before[0] * after[0] + before[1] * after[1] + before[2] * after[2] <= 0.0;
+            }
+
+            if(flips)
+                continue;
+
+            collapseTarget[collapse.from] = collapse.to;
+            worstCost = max(worstCost, (double) collapse.cost);
+            trianglesRemoved += removed;
+            collapsesApplied++;
+
+            // Freeze the whole one-ring so later flip checks in this pass
+            // still see the triangles as they will end up
+            for(size_t j = adjacencyOffsets[collapse.from]; j < adjacencyOffsets[collapse.from + 1]; j++)
+            {
+                GLuint* triangle = &result[adjacency[j] * 3];
+                touched[triangle[0]] = 1;
+                touched[triangle[1]] = 1;
+                touched[triangle[2]] = 1;
+            }
+        }
+
+        if(collapsesApplied == 0)
+            break;
+
+        for(size_t vertex = 0; vertex < vertexCount; vertex++)
+        {
+            if(collapseTarget[vertex] != vertex)
+            {
+                addQuadric(quadrics[collapseTarget[vertex]], quadrics[vertex]);
+            }
+        }
+
+        size_t writePosition = 0;
+        for(size_t i = 0; i < result.size(); i += 3)
+        {
+            GLuint a = collapseTarget[result[i]];
+            GLuint b = collapseTarget[result[i + 1]];
+            GLuint c = collapseTarget[result[i + 2]];
+
+            if(a == b || b == c || a == c)
+                continue;
+
+            result[writePosition++] = a;
+            result[writePosition++] = b;
+            result[writePosition++] = c;
+        }
+        result.resize(writePosition);
+    }
+
+    return (float) sqrt(worstCost);
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <vector>
+
+using namespace std;
+
+class MeshSimplifier
+{
+    public:
+        static float simplify(vector<GLuint>& indices, vector<GLfloat>& vertices, size_t targetIndexCount, float maxError, vector<GLuint>& result);
+
+    private:
+        struct Quadric
+        {
+            double a00, a01, a02, a03;
+            double a11, a12, a13;
+            double a22, a23;
+            double a33;
+            double weight;
+        };
+
+        struct Collapse
+        {
+            GLuint from;
+            GLuint to;
+            float cost;
+        };
+
+        static void addPlane(Quadric& quadric, double normal[3], double distance, double weight);
+        static void addQuadric(Quadric& quadric, const Quadric& other);
+        static double evaluate(const Quadric& quadric, const float* position);
+        static double collapseError(const Quadric& quadric, const float* position);
+};
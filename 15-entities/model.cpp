@@ -1,15 +1,40 @@
 #include "model.h"
+#include "meshletbuilder.h"
+#include "meshoptimizer.h"
+#include "meshsimplifier.h"
+#include "objparser.h"
+#include "trace.h"
+#include "vertexhashtable.h"
 
 #include <SDL3/SDL.h>
 
-#include <fstream>
-#include <sstream>
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
 #include <vector>
 
+// Simplification stops once the error reaches this fraction of the mesh size
+static const float maxLodError = 0.02f;
+
 Model::Model()
 {
     indexCount = 0;
+    indexType = GL_UNSIGNED_INT;
+    vertexCount = 0;
+    vertexMemory = 0;
+    quantization = VertexQuantization();
     vao = 0;
+    threadPool = NULL;
+    geometryPool = NULL;
+    stagingBuffer = NULL;
+    poolAllocation = GeometryAllocation();
+    poolAllocation.page = -1;
+    cacheEnabled = true;
+    optimizeEnabled = false;
+    lodEnabled = false;
+    meshletsEnabled = false;
+    optimization = MeshOptimization();
+    prepared.ready = false;
 
     for(int i = 0; i < 4; i++)
     {
@@ -22,9 +47,72 @@ void Model::setFilename(string newModelFilename)
     filename = SDL_GetBasePath() + newModelFilename;
 }
 
+void Model::setThreadPool(ThreadPool* newThreadPool)
+{
+    threadPool = newThreadPool;
+}
+
+void Model::setGeometryPool(GeometryPool* newGeometryPool)
+{
+    geometryPool = newGeometryPool;
+}
+
+void Model::setStagingBuffer(StagingBuffer* newStagingBuffer)
+{
+    stagingBuffer = newStagingBuffer;
+}
+
+void Model::setCacheEnabled(bool enabled)
+{
+    cacheEnabled = enabled;
+}
+
+void Model::setVertexLayout(VertexLayout layout)
+{
+    vertexFormat.setLayout(layout);
+}
+
+void Model::setOptimizeEnabled(bool enabled)
+{
+    optimizeEnabled = enabled;
+}
+
+void Model::setLodEnabled(bool enabled)
+{
+    lodEnabled = enabled;
+}
+
+void Model::setMeshletsEnabled(bool enabled)
+{
+    meshletsEnabled = enabled;
+}
+
 bool Model::loadOBJModel()
 {
-    deleteModel();
+    return prepareOBJModel() && uploadOBJModel();
+}
+
+// Reads, parses and processes the model without making any OpenGL calls, so
+// this can run on a worker thread. The model currently loaded is untouched.
+bool Model::prepareOBJModel()
+{
+    LoadStatistics::begin(loadRecord, "model", filename);
+    TRACE_ZONE_DETAIL("prepareOBJModel", loadRecord.name.c_str());
+    loadTimer.start();
+
+    bool ready = prepareMesh();
+    if(!ready)
+    {
+        LoadStatistics::add(loadRecord, false);
+    }
+
+    return ready;
+}
+
+bool Model::prepareMesh()
+{
+    clearPreparedModel();
+    errorMessage = "";
 
     if(filename.empty())
     {
@@ -32,117 +120,385 @@ bool Model::loadOBJModel()
         return false;
     }
 
-    ifstream fileStream(filename);
-    if(!fileStream)
+    string cacheFilename = filename + ".meshcache";
+    if(cacheEnabled)
+    {
+        if(prepared.cache.open(cacheFilename, filename, getCacheSettings()))
+        {
+            if(prepareFromCache())
+            {
+                loadTimer.endPhase(loadRecord, LOAD_PHASE_CACHE);
+                return true;
+            }
+
+            // A cache that fails validation is deleted and rebuilt from the
+            // OBJ below, so one bad file cannot leave the model unloadable
+            clearPreparedModel();
+            errorMessage = "";
+
+            error_code error;
+            filesystem::remove(cacheFilename, error);
+        }
+        loadTimer.endPhase(loadRecord, LOAD_PHASE_CACHE);
+    }
+
+    FileView file;
+    if(!file.open(filename))
+    {
+        errorMessage = file.getError();
+        return false;
+    }
+    loadRecord.bytesRead = file.getSize();
+    loadTimer.endPhase(loadRecord, LOAD_PHASE_READ);
+
+    MeshData& mesh = prepared.mesh;
+    if(!parseOBJFile(file, mesh))
     {
-        errorMessage += "Cannot open file: ";
-        errorMessage += filename;
         return false;
     }
+    loadTimer.endPhase(loadRecord, LOAD_PHASE_DEDUPLICATE);
+
+    size_t meshVertexCount = mesh.vertices.size() / 3;
+    if(optimizeEnabled)
+    {
+        prepared.optimization.acmrBefore = MeshOptimizer::calculateACMR(mesh.indices, meshVertexCount);
+        MeshOptimizer::optimizeVertexCache(mesh.indices, meshVertexCount);
+    }
+
+    // Meshlets follow the cache-optimized triangle order, so splitting them
+    // out costs little vertex reuse
+    if(meshletsEnabled)
+    {
+        MeshletBuilder::build(mesh.indices, mesh.vertices, prepared.meshlets);
+    }
+
+    if(optimizeEnabled)
+    {
+        MeshOptimizer::optimizeVertexFetch(mesh);
+        prepared.optimization.acmrAfter = MeshOptimizer::calculateACMR(mesh.indices, meshVertexCount);
+    }
+
+    ModelLod fullDetail = {0, (GLuint) mesh.indices.size(), 0.0f};
+    prepared.lods.push_back(fullDetail);
+
+    if(lodEnabled)
+    {
+        generateLods(mesh, prepared.lods);
+    }
+
+    vertexFormat.buildBuffers(mesh, prepared.vertexStorage, prepared.bufferData, prepared.bufferSizes, prepared.quantization);
+
+    // Most props have few enough vertices for 16-bit indices, which halves
+    // the index memory and bandwidth
+    prepared.indexType = chooseIndexType(mesh.vertices.size() / 3);
+
+    prepared.indexData = mesh.indices.data();
+    prepared.indexSize = sizeof(GLuint) * mesh.indices.size();
+    if(prepared.indexType == GL_UNSIGNED_SHORT)
+    {
+        prepared.shortIndices.assign(mesh.indices.begin(), mesh.indices.end());
+        prepared.indexData = prepared.shortIndices.data();
+        prepared.indexSize = sizeof(GLushort) * prepared.shortIndices.size();
+    }
+
+    prepared.boundsMin = mesh.boundsMin;
+    prepared.boundsMax = mesh.boundsMax;
+    loadTimer.endPhase(loadRecord, LOAD_PHASE_PROCESS);
+
+    // Failing to write the cache only costs the next load some time, so it
+    // is not treated as an error
+    if(cacheEnabled)
+    {
+        vector<MeshCacheSection> sections;
+        for(int i = 0; i < vertexFormat.getBufferCount(); i++)
+        {
+            MeshCacheSection section = {(uint32_t) (MESH_CACHE_VERTEX_BUFFER_0 + i), prepared.bufferData[i], (uint64_t) prepared.bufferSizes[i]};
+            sections.push_back(section);
+        }
+
+        MeshCacheSection indexSection = {MESH_CACHE_INDICES, prepared.indexData, (uint64_t) prepared.indexSize};
+        sections.push_back(indexSection);
+
+        MeshCacheSection quantizationSection = {MESH_CACHE_QUANTIZATION, &prepared.quantization, sizeof(prepared.quantization)};
+        sections.push_back(quantizationSection);
 
-    vector<float> fileVertexData;
-    vector<float> fileTextureData;
-    vector<float> fileNormalData;
+        MeshCacheSection optimizationSection = {MESH_CACHE_OPTIMIZATION, &prepared.optimization, sizeof(prepared.optimization)};
+        sections.push_back(optimizationSection);
 
-    string line, lineIdentifier;
-    float value1, value2, value3;
+        MeshCacheSection lodSection = {MESH_CACHE_LODS, prepared.lods.data(), sizeof(ModelLod) * prepared.lods.size()};
+        sections.push_back(lodSection);
+
+        MeshCacheSection meshletSection = {MESH_CACHE_MESHLETS, prepared.meshlets.data(), sizeof(Meshlet) * prepared.meshlets.size()};
+        sections.push_back(meshletSection);
+
+        MeshCache cache;
+        cache.write(cacheFilename, filename, getCacheSettings(), file, sections, prepared.boundsMin, prepared.boundsMax);
+        loadTimer.endPhase(loadRecord, LOAD_PHASE_CACHE);
+    }
+
+    prepared.ready = true;
+    return true;
+}
+
+// Replaces the current model with the prepared one. Must be called on the
+// GL thread.
+bool Model::uploadOBJModel()
+{
+    TRACE_ZONE_DETAIL("uploadOBJModel", loadRecord.name.c_str());
 
-    while(getline(fileStream, line))
+    if(!prepared.ready)
     {
-        istringstream iss(line);
-        iss >> lineIdentifier >> value1 >> value2 >> value3;
+        errorMessage = "Model has not been prepared: ";
+        errorMessage += filename;
+        return false;
+    }
+
+    loadTimer.start();
+
+    // The new buffers are created before the old ones are released, so a
+    // failed upload or reload leaves the current version in place
+    ModelBuffers buffers = ModelBuffers();
+    buffers.poolAllocation.page = -1;
+    bool created = createBuffers(prepared.bufferData, prepared.bufferSizes, prepared.indexData, prepared.indexSize, buffers);
+    if(created)
+    {
+        deleteModel();
+
+        poolAllocation = buffers.poolAllocation;
+        vao = buffers.vao;
+        for(int i = 0; i < 4; i++)
+        {
+            vbo[i] = buffers.vbo[i];
+        }
 
-        if(lineIdentifier == "v")
+        indexType = prepared.indexType;
+        quantization = prepared.quantization;
+        optimization = prepared.optimization;
+        lods.swap(prepared.lods);
+        meshlets.swap(prepared.meshlets);
+        boundsMin = prepared.boundsMin;
+        boundsMax = prepared.boundsMax;
+
+        indexCount = lods[0].indexCount;
+        vertexCount = prepared.bufferSizes[0] / vertexFormat.getStride(0);
+        vertexMemory = 0;
+        for(int i = 0; i < vertexFormat.getBufferCount(); i++)
         {
-            fileVertexData.push_back(value1);
-            fileVertexData.push_back(value2);
-            fileVertexData.push_back(value3);
+            vertexMemory += prepared.bufferSizes[i];
         }
-        else if(lineIdentifier == "vt")
+
+        loadRecord.vertexMemorySaved = getVertexMemorySaved();
+        loadRecord.maxPositionError = quantization.maxPositionError;
+        loadRecord.maxNormalError = quantization.maxNormalError;
+    }
+
+    loadRecord.acmrBefore = prepared.optimization.acmrBefore;
+    loadRecord.acmrAfter = prepared.optimization.acmrAfter;
+    loadRecord.bytesUploaded = prepared.indexSize;
+    for(int i = 0; i < vertexFormat.getBufferCount(); i++)
+    {
+        loadRecord.bytesUploaded += prepared.bufferSizes[i];
+    }
+    loadTimer.endPhase(loadRecord, LOAD_PHASE_UPLOAD);
+    LoadStatistics::add(loadRecord, created);
+
+    clearPreparedModel();
+
+    return created;
+}
+
+static bool indicesInRange(const void* indexData, GLuint indexCount, GLenum indexType, GLsizeiptr vertexCount)
+{
+    GLuint maxIndex = 0;
+    if(indexType == GL_UNSIGNED_SHORT)
+    {
+        const GLushort* indices = (const GLushort*) indexData;
+        for(GLuint i = 0; i < indexCount; i++)
         {
-            fileTextureData.push_back(value1);
-            fileTextureData.push_back(value2);
+            maxIndex = max(maxIndex, (GLuint) indices[i]);
         }
-        else if(lineIdentifier == "vn")
+    }
+    else
+    {
+        const GLuint* indices = (const GLuint*) indexData;
+        for(GLuint i = 0; i < indexCount; i++)
         {
-            fileNormalData.push_back(value1);
-            fileNormalData.push_back(value2);
-            fileNormalData.push_back(value3);
+            maxIndex = max(maxIndex, indices[i]);
         }
     }
+    return maxIndex < vertexCount;
+}
 
-    fileStream.clear();
-    fileStream.seekg(0);
+bool Model::prepareFromCache()
+{
+    MeshCache& cache = prepared.cache;
+    for(int i = 0; i < vertexFormat.getBufferCount(); i++)
+    {
+        prepared.bufferData[i] = cache.getSectionData(MESH_CACHE_VERTEX_BUFFER_0 + i);
+        prepared.bufferSizes[i] = cache.getSectionSize(MESH_CACHE_VERTEX_BUFFER_0 + i);
+    }
 
-    vector<GLfloat> vertices;
-    vector<GLfloat> textureCoordinates;
-    vector<GLfloat> normals;
-    vector<GLuint> indices;
+    GLsizeiptr indexSize = cache.getSectionSize(MESH_CACHE_INDICES);
+    prepared.indexData = cache.getSectionData(MESH_CACHE_INDICES);
+    prepared.indexSize = indexSize;
+
+    GLsizeiptr vertexCount = prepared.bufferSizes[0] / vertexFormat.getStride(0);
+    prepared.indexType = chooseIndexType(vertexCount);
+    int indexTypeSize = prepared.indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+
+    uint64_t lodSize = cache.getSectionSize(MESH_CACHE_LODS);
+    const ModelLod* cachedLods = (const ModelLod*) cache.getSectionData(MESH_CACHE_LODS);
+    uint64_t meshletSize = cache.getSectionSize(MESH_CACHE_MESHLETS);
+    const Meshlet* cachedMeshlets = (const Meshlet*) cache.getSectionData(MESH_CACHE_MESHLETS);
+
+    bool sizesMatch = indexSize > 0 && indexSize % indexTypeSize == 0 &&
+                      cache.getSectionSize(MESH_CACHE_QUANTIZATION) == sizeof(VertexQuantization) &&
+                      cache.getSectionSize(MESH_CACHE_OPTIMIZATION) == sizeof(MeshOptimization) &&
+                      lodSize >= sizeof(ModelLod) && lodSize % sizeof(ModelLod) == 0 &&
+                      meshletSize % sizeof(Meshlet) == 0;
+    for(int i = 0; i < vertexFormat.getBufferCount(); i++)
+    {
+        sizesMatch = sizesMatch && vertexCount > 0 && prepared.bufferSizes[i] == vertexCount * vertexFormat.getStride(i);
+    }
 
-    int uniqueElements = 0;
-    vector<string> elementBuffer;
+    GLuint totalIndices = indexSize / indexTypeSize;
+    for(uint64_t i = 0; sizesMatch && i < lodSize / sizeof(ModelLod); i++)
+    {
+        sizesMatch = cachedLods[i].firstIndex <= totalIndices && cachedLods[i].indexCount <= totalIndices - cachedLods[i].firstIndex;
+    }
 
-    while(getline(fileStream, line))
+    // Meshlets only ever index into the full detail level
+    for(uint64_t i = 0; sizesMatch && i < meshletSize / sizeof(Meshlet); i++)
     {
-        istringstream iss(line);
-        iss >> lineIdentifier;
+        sizesMatch = cachedMeshlets[i].firstIndex <= cachedLods[0].indexCount && cachedMeshlets[i].indexCount <= cachedLods[0].indexCount - cachedMeshlets[i].firstIndex;
+    }
 
-        if(lineIdentifier != "f")
-            continue;
+    // Every index must name a vertex, or a damaged cache would send
+    // out of range indices to the GPU
+    if(sizesMatch)
+    {
+        sizesMatch = indicesInRange(prepared.indexData, totalIndices, prepared.indexType, vertexCount);
+    }
 
-        string element;
-        for(int elementIndex = 0; elementIndex < 3; elementIndex++)
-        {
-            iss >> element;
+    if(!sizesMatch)
+    {
+        errorMessage = "Mesh cache is corrupt: ";
+        errorMessage += filename;
+        return false;
+    }
 
-            bool alreadyExists = false;
-            for(int i = 0; i < (int) elementBuffer.size(); i++)
-            {
-                if(elementBuffer[i] == element)
-                {
-                    indices.push_back(i);
-                    alreadyExists = true;
-                    break;
-                }
-            }
+    memcpy(&prepared.quantization, cache.getSectionData(MESH_CACHE_QUANTIZATION), sizeof(VertexQuantization));
+    memcpy(&prepared.optimization, cache.getSectionData(MESH_CACHE_OPTIMIZATION), sizeof(MeshOptimization));
+    prepared.lods.assign(cachedLods, cachedLods + lodSize / sizeof(ModelLod));
+    prepared.meshlets.assign(cachedMeshlets, cachedMeshlets + meshletSize / sizeof(Meshlet));
 
-            if(alreadyExists)
-                continue;
-            
-            int vertexIndex, textureIndex, normalIndex;
-            sscanf(element.c_str(), "%i/%i/%i", &vertexIndex, &textureIndex, &normalIndex);
-
-            int vertexLocation = (vertexIndex - 1) * 3;
-            vertices.push_back(fileVertexData[vertexLocation + 0]);
-            vertices.push_back(fileVertexData[vertexLocation + 1]);
-            vertices.push_back(fileVertexData[vertexLocation + 2]);
-
-            int textureLocation = (textureIndex - 1) * 2;
-            textureCoordinates.push_back(fileTextureData[textureLocation + 0]);
-            textureCoordinates.push_back(fileTextureData[textureLocation + 1]);
- 
-            int normalLocation = (normalIndex - 1) * 3;
-            normals.push_back(fileNormalData[normalLocation + 0]);
-            normals.push_back(fileNormalData[normalLocation + 1]);
-            normals.push_back(fileNormalData[normalLocation + 2]);
-
-            indices.push_back(uniqueElements);
-
-            elementBuffer.push_back(element);
-            uniqueElements++;
-        }
+    prepared.boundsMin = cache.getBoundsMin();
+    prepared.boundsMax = cache.getBoundsMax();
+
+    loadRecord.fromCache = true;
+    loadRecord.bytesRead = indexSize;
+    for(int i = 0; i < vertexFormat.getBufferCount(); i++)
+    {
+        loadRecord.bytesRead += prepared.bufferSizes[i];
+    }
 
-        element = "";
-        iss >> element;
-        if(element.length() != 0)
+    // The buffer pointers refer straight into the mapped cache file, so the
+    // driver reads them without any intermediate copy
+    prepared.ready = true;
+    return true;
+}
+
+void Model::clearPreparedModel()
+{
+    prepared.ready = false;
+    prepared.mesh = MeshData();
+    prepared.cache.close();
+    prepared.vertexStorage.clear();
+    prepared.vertexStorage.shrink_to_fit();
+    prepared.shortIndices.clear();
+    prepared.shortIndices.shrink_to_fit();
+    prepared.indexData = NULL;
+    prepared.indexSize = 0;
+    prepared.quantization = VertexQuantization();
+    prepared.optimization = MeshOptimization();
+    prepared.lods.clear();
+    prepared.meshlets.clear();
+}
+
+bool Model::parseOBJFile(FileView& file, MeshData& mesh)
+{
+    OBJParser parser;
+    if(!parser.parse(file.getData(), file.getSize(), threadPool))
+    {
+        errorMessage = parser.getError() + ": " + filename;
+        return false;
+    }
+    loadTimer.endPhase(loadRecord, LOAD_PHASE_PARSE);
+
+    vector<float>& fileVertexData = parser.getPositions();
+    vector<float>& fileTextureData = parser.getTextureCoordinates();
+    vector<float>& fileNormalData = parser.getNormals();
+    vector<GLuint>& faceElements = parser.getFaceElements();
+
+    GLuint fileVertexCount = fileVertexData.size() / 3;
+    GLuint fileTextureCount = fileTextureData.size() / 2;
+    GLuint fileNormalCount = fileNormalData.size() / 3;
+    size_t cornerCount = faceElements.size() / 3;
+
+    vector<GLfloat>& vertices = mesh.vertices;
+    vector<GLfloat>& textureCoordinates = mesh.textureCoordinates;
+    vector<GLfloat>& normals = mesh.normals;
+    vector<GLuint>& indices = mesh.indices;
+
+    // Most meshes share each vertex between several faces, so half the
+    // corner count is a reasonable first estimate of the unique elements
+    indices.reserve(cornerCount);
+    vertices.reserve(cornerCount / 2 * 3);
+    textureCoordinates.reserve(cornerCount / 2 * 2);
+    normals.reserve(cornerCount / 2 * 3);
+
+    GLuint uniqueElements = 0;
+    VertexHashTable elementTable;
+    elementTable.reserve(cornerCount / 2);
+
+    for(size_t corner = 0; corner < cornerCount; corner++)
+    {
+        GLuint vertexIndex = faceElements[corner * 3 + 0];
+        GLuint textureIndex = faceElements[corner * 3 + 1];
+        GLuint normalIndex = faceElements[corner * 3 + 2];
+
+        if(vertexIndex < 1 || vertexIndex > fileVertexCount ||
+           textureIndex < 1 || textureIndex > fileTextureCount ||
+           normalIndex < 1 || normalIndex > fileNormalCount)
         {
-            errorMessage = "File contains non-triangulated faces: ";
+            errorMessage = "File contains invalid face element: ";
             errorMessage += filename;
             return false;
         }
-    }
 
-    fileStream.close();
+        bool inserted;
+        GLuint existingElement = elementTable.findOrInsert(vertexIndex, textureIndex, normalIndex, uniqueElements, inserted);
+        indices.push_back(existingElement);
+
+        if(!inserted)
+            continue;
+
+        size_t vertexLocation = (size_t) (vertexIndex - 1) * 3;
+        vertices.push_back(fileVertexData[vertexLocation + 0]);
+        vertices.push_back(fileVertexData[vertexLocation + 1]);
+        vertices.push_back(fileVertexData[vertexLocation + 2]);
+
+        size_t textureLocation = (size_t) (textureIndex - 1) * 2;
+        textureCoordinates.push_back(fileTextureData[textureLocation + 0]);
+        textureCoordinates.push_back(fileTextureData[textureLocation + 1]);
+
+        size_t normalLocation = (size_t) (normalIndex - 1) * 3;
+        normals.push_back(fileNormalData[normalLocation + 0]);
+        normals.push_back(fileNormalData[normalLocation + 1]);
+        normals.push_back(fileNormalData[normalLocation + 2]);
+
+        uniqueElements++;
+    }
 
     if(vertices.empty() || normals.empty() || textureCoordinates.empty() || indices.empty())
     {
@@ -151,45 +507,122 @@ bool Model::loadOBJModel()
         return false;
     }
 
-    glGenVertexArrays(1, &vao);
-    glBindVertexArray(vao);
+    mesh.boundsMin = glm::vec3(vertices[0], vertices[1], vertices[2]);
+    mesh.boundsMax = mesh.boundsMin;
+    for(size_t i = 0; i < vertices.size(); i += 3)
+    {
+        glm::vec3 position(vertices[i], vertices[i + 1], vertices[i + 2]);
+        mesh.boundsMin = glm::min(mesh.boundsMin, position);
+        mesh.boundsMax = glm::max(mesh.boundsMax, position);
+    }
+
+    return true;
+}
+
+bool Model::createBuffers(const void* bufferData[], GLsizeiptr bufferSizes[], const void* indexData, GLsizeiptr indexSize, ModelBuffers& buffers)
+{
+    if(geometryPool != NULL)
+    {
+        GLsizei newVertexCount = bufferSizes[0] / vertexFormat.getStride(0);
+        if(!geometryPool->allocate(vertexFormat, newVertexCount, indexSize, buffers.poolAllocation))
+        {
+            errorMessage = "Unable to allocate space in the geometry pool: ";
+            errorMessage += filename;
+            return false;
+        }
+
+        geometryPool->upload(buffers.poolAllocation, bufferData, indexData, indexSize, stagingBuffer);
+        return true;
+    }
+
+    glCreateBuffers(4, buffers.vbo);
+
+    // With a staging buffer the storage is allocated empty and filled by
+    // copies on the GPU rather than from client memory. Copies are allowed
+    // into immutable storage, so no flags are needed either way.
+    bool staged = stagingBuffer != NULL && stagingBuffer->isCreated();
+
+    for(int i = 0; i < vertexFormat.getBufferCount(); i++)
+    {
+        glNamedBufferStorage(buffers.vbo[i], bufferSizes[i], staged ? NULL : bufferData[i], 0);
+    }
+    glNamedBufferStorage(buffers.vbo[3], indexSize, staged ? NULL : indexData, 0);
 
-    glGenBuffers(4, vbo);
+    glCreateVertexArrays(1, &buffers.vao);
+    vertexFormat.setupAttributes(buffers.vao, buffers.vbo);
+    glVertexArrayElementBuffer(buffers.vao, buffers.vbo[3]);
 
-    glBindBuffer(GL_ARRAY_BUFFER, vbo[0]);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices[0]) * vertices.size(), vertices.data(), GL_STATIC_DRAW);
+    if(staged)
+    {
+        for(int i = 0; i < vertexFormat.getBufferCount(); i++)
+        {
+            stagingBuffer->copyToBuffer(buffers.vbo[i], 0, bufferData[i], bufferSizes[i]);
+        }
+        stagingBuffer->copyToBuffer(buffers.vbo[3], 0, indexData, indexSize);
+    }
 
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
+    return true;
+}
 
-    glBindBuffer(GL_ARRAY_BUFFER, vbo[1]);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(normals[0]) * normals.size(), normals.data(), GL_STATIC_DRAW);
+void Model::generateLods(MeshData& mesh, vector<ModelLod>& meshLods)
+{
+    // Each level halves the triangle count of the previous one, until the
+    // simplifier can no longer get close to that within the error limit
+    size_t vertexCount = mesh.vertices.size() / 3;
+    vector<GLuint> allIndices = mesh.indices;
+    vector<GLuint> previous = mesh.indices;
+    float previousError = 0.0f;
+
+    while((int) meshLods.size() < maxLods)
+    {
+        size_t targetIndexCount = previous.size() / 6 * 3;
 
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, 0);
+        vector<GLuint> simplified;
+        float error = MeshSimplifier::simplify(previous, mesh.vertices, targetIndexCount, maxLodError, simplified);
+        if(simplified.empty() || simplified.size() > previous.size() * 3 / 4)
+            break;
 
-    glBindBuffer(GL_ARRAY_BUFFER, vbo[2]);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(textureCoordinates[0]) * textureCoordinates.size(), textureCoordinates.data(), GL_STATIC_DRAW);
+        if(optimizeEnabled)
+        {
+            MeshOptimizer::optimizeVertexCache(simplified, vertexCount);
+        }
 
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, 0);
+        previousError += error;
+        ModelLod lod = {(GLuint) allIndices.size(), (GLuint) simplified.size(), previousError};
+        meshLods.push_back(lod);
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vbo[3]);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices[0]) * indices.size(), indices.data(), GL_STATIC_DRAW);
+        allIndices.insert(allIndices.end(), simplified.begin(), simplified.end());
+        previous.swap(simplified);
+    }
 
-    glBindVertexArray(0);
+    mesh.indices.swap(allIndices);
+}
 
-    indexCount = indices.size();
+GLenum Model::chooseIndexType(size_t vertexCount)
+{
+    return vertexCount <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
 
-    return true;
+uint32_t Model::getCacheSettings()
+{
+    return vertexFormat.getLayout() | (optimizeEnabled ? 0x100 : 0) | (lodEnabled ? 0x200 : 0) | (meshletsEnabled ? 0x400 : 0);
 }
 
 void Model::deleteModel()
 {
+    if(poolAllocation.page >= 0)
+    {
+        geometryPool->free(poolAllocation);
+    }
+
     glDeleteVertexArrays(1, &vao);
     glDeleteBuffers(4, vbo);
 
     indexCount = 0;
+    vertexCount = 0;
+    vertexMemory = 0;
+    lods.clear();
+    meshlets.clear();
     vao = 0;
 
     for(int i = 0; i < 4; i++)
@@ -202,12 +635,29 @@ void Model::deleteModel()
 
 void Model::bind()
 {
-    glBindVertexArray(vao);
+    if(poolAllocation.page >= 0)
+    {
+        geometryPool->bind(poolAllocation.page);
+    }
+    else
+    {
+        glBindVertexArray(vao);
+    }
 }
 
+// Pooled models leave the shared VAO bound for the next model on the same
+// page, and the pool itself is unbound once drawing is finished
 void Model::unbind()
 {
-    glBindVertexArray(0);
+    if(poolAllocation.page < 0)
+    {
+        glBindVertexArray(0);
+    }
+}
+
+bool Model::isLoaded()
+{
+    return indexCount > 0;
 }
 
 int Model::getIndexCount()
@@ -215,6 +665,124 @@ int Model::getIndexCount()
     return indexCount;
 }
 
+GLenum Model::getIndexType()
+{
+    return indexType;
+}
+
+int Model::getIndexSize()
+{
+    return indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+}
+
+int Model::getVertexCount()
+{
+    return vertexCount;
+}
+
+size_t Model::getVertexMemory()
+{
+    return vertexMemory;
+}
+
+size_t Model::getVertexMemorySaved()
+{
+    size_t floatVertexMemory = (size_t) vertexCount * 8 * sizeof(GLfloat);
+    return floatVertexMemory - vertexMemory;
+}
+
+VertexQuantization Model::getQuantization()
+{
+    return quantization;
+}
+
+// The geometry pool page holding the model, or -1 if it has its own buffers
+int Model::getPoolPage()
+{
+    return poolAllocation.page;
+}
+
+int Model::getLodCount()
+{
+    return lods.size();
+}
+
+GLsizei Model::getLodIndexCount(int lod)
+{
+    return lods[lod].indexCount;
+}
+
+const void* Model::getLodIndexOffset(int lod)
+{
+    return getIndexOffset(lods[lod].firstIndex);
+}
+
+const void* Model::getIndexOffset(GLuint firstIndex)
+{
+    uintptr_t offset = (uintptr_t) firstIndex * getIndexSize();
+    if(poolAllocation.page >= 0)
+    {
+        offset += poolAllocation.indexOffset;
+    }
+    return (const void*) offset;
+}
+
+GLint Model::getBaseVertex()
+{
+    return poolAllocation.page >= 0 ? poolAllocation.baseVertex : 0;
+}
+
+float Model::getLodError(int lod)
+{
+    return lods[lod].error;
+}
+
+int Model::getMeshletCount()
+{
+    return meshlets.size();
+}
+
+const Meshlet& Model::getMeshlet(int meshlet)
+{
+    return meshlets[meshlet];
+}
+
+glm::vec3 Model::getBoundingCenter()
+{
+    return (boundsMin + boundsMax) * 0.5f;
+}
+
+float Model::getBoundingRadius()
+{
+    return glm::length(boundsMax - boundsMin) * 0.5f;
+}
+
+MeshOptimization Model::getOptimization()
+{
+    return optimization;
+}
+
+VertexFormat& Model::getVertexFormat()
+{
+    return vertexFormat;
+}
+
+glm::vec3 Model::getBoundsMin()
+{
+    return boundsMin;
+}
+
+glm::vec3 Model::getBoundsMax()
+{
+    return boundsMax;
+}
+
+// Only meaningful while the model is not loading
+LoadRecord Model::getLoadRecord()
+{
+    return loadRecord;
+}
+
 string Model::getFilename()
 {
     return filename;
@@ -1,17 +1,94 @@
 #pragma once
 
+#include "fileview.h"
+#include "geometrypool.h"
+#include "loadstatistics.h"
+#include "meshcache.h"
+#include "meshletbuilder.h"
+#include "threadpool.h"
+#include "vertexformat.h"
+
 #include <GL/glew.h>
+#include <glm/glm.hpp>
 #include <string>
+#include <vector>
 
 using namespace std;
 
+struct MeshData
+{
+    vector<GLfloat> vertices;
+    vector<GLfloat> normals;
+    vector<GLfloat> textureCoordinates;
+    vector<GLuint> indices;
+
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+};
+
+struct ModelLod
+{
+    GLuint firstIndex;
+    GLuint indexCount;
+    float error;
+};
+
+struct MeshOptimization
+{
+    float acmrBefore;
+    float acmrAfter;
+};
+
+// Everything a load produces before any OpenGL calls are made. The buffer
+// pointers refer either to the vectors here or into the mapped cache file.
+struct PreparedModel
+{
+    bool ready;
+
+    MeshData mesh;
+    MeshCache cache;
+    vector<unsigned char> vertexStorage;
+    vector<GLushort> shortIndices;
+
+    const void* bufferData[VertexFormat::maxBuffers];
+    GLsizeiptr bufferSizes[VertexFormat::maxBuffers];
+    const void* indexData;
+    GLsizeiptr indexSize;
+    GLenum indexType;
+
+    VertexQuantization quantization;
+    MeshOptimization optimization;
+    vector<ModelLod> lods;
+    vector<Meshlet> meshlets;
+
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+};
+
+struct ModelBuffers
+{
+    GeometryAllocation poolAllocation;
+    GLuint vao;
+    GLuint vbo[4];
+};
+
 class Model
 {
     public:
         Model();
 
         void setFilename(string newModelFilename);
+        void setThreadPool(ThreadPool* newThreadPool);
+        void setGeometryPool(GeometryPool* newGeometryPool);
+        void setStagingBuffer(StagingBuffer* newStagingBuffer);
+        void setCacheEnabled(bool enabled);
+        void setVertexLayout(VertexLayout layout);
+        void setOptimizeEnabled(bool enabled);
+        void setLodEnabled(bool enabled);
+        void setMeshletsEnabled(bool enabled);
         bool loadOBJModel();
+        bool prepareOBJModel();
+        bool uploadOBJModel();
         void deleteModel();
 
         void bind();
@@ -19,13 +96,75 @@ class Model
         
         string getFilename();
         string getError();
+        bool isLoaded();
         int getIndexCount();
+        GLenum getIndexType();
+        int getIndexSize();
+        int getVertexCount();
+        size_t getVertexMemory();
+        size_t getVertexMemorySaved();
+        VertexQuantization getQuantization();
+        int getPoolPage();
+        MeshOptimization getOptimization();
+        VertexFormat& getVertexFormat();
+        int getLodCount();
+        GLsizei getLodIndexCount(int lod);
+        const void* getLodIndexOffset(int lod);
+        const void* getIndexOffset(GLuint firstIndex);
+        GLint getBaseVertex();
+        float getLodError(int lod);
+        int getMeshletCount();
+        const Meshlet& getMeshlet(int meshlet);
+
+        glm::vec3 getBoundingCenter();
+        float getBoundingRadius();
+        glm::vec3 getBoundsMin();
+        glm::vec3 getBoundsMax();
+        LoadRecord getLoadRecord();
 
     private:
         string filename;
         string errorMessage;
         int indexCount;
+        GLenum indexType;
+        int vertexCount;
+        size_t vertexMemory;
+
+        ThreadPool* threadPool;
+        bool cacheEnabled;
+        bool optimizeEnabled;
+        bool lodEnabled;
+        bool meshletsEnabled;
+        MeshOptimization optimization;
+
+        LoadRecord loadRecord;
+        LoadTimer loadTimer;
+
+        glm::vec3 boundsMin;
+        glm::vec3 boundsMax;
+
+        VertexFormat vertexFormat;
+        VertexQuantization quantization;
+
+        static const int maxLods = 4;
+        vector<ModelLod> lods;
+        vector<Meshlet> meshlets;
+
+        GeometryPool* geometryPool;
+        StagingBuffer* stagingBuffer;
+        GeometryAllocation poolAllocation;
 
         GLuint vao;
         GLuint vbo[4];
+
+        PreparedModel prepared;
+
+        bool parseOBJFile(FileView& file, MeshData& mesh);
+        bool prepareMesh();
+        bool prepareFromCache();
+        void clearPreparedModel();
+        bool createBuffers(const void* bufferData[], GLsizeiptr bufferSizes[], const void* indexData, GLsizeiptr indexSize, ModelBuffers& buffers);
+        void generateLods(MeshData& mesh, vector<ModelLod>& meshLods);
+        GLenum chooseIndexType(size_t vertexCount);
+        uint32_t getCacheSettings();
 };
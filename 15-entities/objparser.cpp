@@ -0,0 +1,313 @@
+#include "objparser.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+
+static const size_t minimumChunkSize = 1 << 20;
+
+OBJParser::OBJParser()
+{
+}
+
+static inline const char* skipSpaces(const char* cursor, const char* end)
+{
+    while(cursor < end && (*cursor == ' ' || *cursor == '\t'))
+    {
+        cursor++;
+    }
+    return cursor;
+}
+
+static inline const char* skipLine(const char* cursor, const char* end)
+{
+    const char* newline = (const char*) memchr(cursor, '\n', end - cursor);
+    return newline ? newline + 1 : end;
+}
+
+static inline bool isLineEnd(const char* cursor, const char* end)
+{
+    return cursor >= end || *cursor == '\n' || *cursor == '\r' || *cursor == '#';
+}
+
+void OBJParser::clear()
+{
+    positions.clear();
+    textureCoordinates.clear();
+    normals.clear();
+    faceElements.clear();
+    errorMessage = "";
+}
+
+void OBJParser::reserveFromLineCounts(const char* data, size_t length)
+{
+    // A memchr sweep over the line starts is far cheaper than parsing, and
+    // lets every output vector be allocated exactly once
+    size_t vertexLines = 0, textureLines = 0, normalLines = 0, faceLines = 0;
+
+    const char* cursor = data;
+    const char* end = data + length;
+    while(cursor < end)
+    {
+        if(end - cursor >= 2)
+        {
+            if(cursor[0] == 'v')
+            {
+                if(cursor[1] == ' ' || cursor[1] == '\t')
+                    vertexLines++;
+                else if(cursor[1] == 't')
+                    textureLines++;
+                else if(cursor[1] == 'n')
+                    normalLines++;
+            }
+            else if(cursor[0] == 'f' && (cursor[1] == ' ' || cursor[1] == '\t'))
+            {
+                faceLines++;
+            }
+        }
+        cursor = skipLine(cursor, end);
+    }
+
+    positions.reserve(positions.size() + vertexLines * 3);
+    textureCoordinates.reserve(textureCoordinates.size() + textureLines * 2);
+    normals.reserve(normals.size() + normalLines * 3);
+    faceElements.reserve(faceElements.size() + faceLines * 9);
+}
+
+bool OBJParser::parseFloats(const char*& cursor, const char* end, float* values, int count)
+{
+    for(int i = 0; i < count; i++)
+    {
+        cursor = skipSpaces(cursor, end);
+        if(cursor < end && *cursor == '+')
+        {
+            cursor++;
+        }
+
+        from_chars_result result = from_chars(cursor, end, values[i]);
+        if(result.ec != errc())
+        {
+            return false;
+        }
+        cursor = result.ptr;
+    }
+    return true;
+}
+
+bool OBJParser::parseFaceElement(const char*& cursor, const char* end, GLuint* element)
+{
+    for(int i = 0; i < 3; i++)
+    {
+        if(i > 0)
+        {
+            if(cursor >= end || *cursor != '/')
+            {
+                return false;
+            }
+            cursor++;
+        }
+
+        from_chars_result result = from_chars(cursor, end, element[i]);
+        if(result.ec != errc())
+        {
+            return false;
+        }
+        cursor = result.ptr;
+    }
+    return true;
+}
+
+bool OBJParser::parse(const char* data, size_t length, ThreadPool* pool)
+{
+    errorMessage = "";
+
+    if(pool != NULL && pool->getThreadCount() > 1 && length >= minimumChunkSize * 2)
+    {
+        return parseChunks(data, length, pool);
+    }
+
+    return parseChunk(data, length);
+}
+
+bool OBJParser::parseChunks(const char* data, size_t length, ThreadPool* pool)
+{
+    // Split at line boundaries into a few chunks per thread so uneven
+    // chunks (e.g. all faces at the end of the file) still balance
+    size_t chunkCount = pool->getThreadCount() * 4;
+    if(chunkCount > length / minimumChunkSize)
+    {
+        chunkCount = length / minimumChunkSize;
+    }
+
+    vector<const char*> chunkStarts;
+    const char* end = data + length;
+    chunkStarts.push_back(data);
+    for(size_t i = 1; i < chunkCount; i++)
+    {
+        const char* split = data + (length / chunkCount) * i;
+        if(split <= chunkStarts.back())
+            continue;
+
+        split = skipLine(split, end);
+        if(split >= end)
+            break;
+
+        chunkStarts.push_back(split);
+    }
+    chunkStarts.push_back(end);
+
+    int parsedChunks = chunkStarts.size() - 1;
+    vector<OBJParser> chunkParsers(parsedChunks);
+    vector<char> chunkSucceeded(parsedChunks);
+
+    pool->parallelFor(parsedChunks, [&](int chunk)
+    {
+        chunkSucceeded[chunk] = chunkParsers[chunk].parseChunk(chunkStarts[chunk], chunkStarts[chunk + 1] - chunkStarts[chunk]);
+    });
+
+    // OBJ indices are global to the file, so concatenating the chunks in
+    // file order gives exactly the same data as parsing serially
+    size_t positionCount = positions.size(), textureCount = textureCoordinates.size();
+    size_t normalCount = normals.size(), faceElementCount = faceElements.size();
+
+    vector<size_t> positionOffsets(parsedChunks), textureOffsets(parsedChunks);
+    vector<size_t> normalOffsets(parsedChunks), faceElementOffsets(parsedChunks);
+
+    for(int chunk = 0; chunk < parsedChunks; chunk++)
+    {
+        if(!chunkSucceeded[chunk])
+        {
+            errorMessage = chunkParsers[chunk].getError();
+            return false;
+        }
+
+        positionOffsets[chunk] = positionCount;
+        textureOffsets[chunk] = textureCount;
+        normalOffsets[chunk] = normalCount;
+        faceElementOffsets[chunk] = faceElementCount;
+
+        positionCount += chunkParsers[chunk].positions.size();
+        textureCount += chunkParsers[chunk].textureCoordinates.size();
+        normalCount += chunkParsers[chunk].normals.size();
+        faceElementCount += chunkParsers[chunk].faceElements.size();
+    }
+
+    positions.resize(positionCount);
+    textureCoordinates.resize(textureCount);
+    normals.resize(normalCount);
+    faceElements.resize(faceElementCount);
+
+    pool->parallelFor(parsedChunks, [&](int chunk)
+    {
+        OBJParser& chunkParser = chunkParsers[chunk];
+        copy(chunkParser.positions.begin(), chunkParser.positions.end(), positions.begin() + positionOffsets[chunk]);
+        copy(chunkParser.textureCoordinates.begin(), chunkParser.textureCoordinates.end(), textureCoordinates.begin() + textureOffsets[chunk]);
+        copy(chunkParser.normals.begin(), chunkParser.normals.end(), normals.begin() + normalOffsets[chunk]);
+        copy(chunkParser.faceElements.begin(), chunkParser.faceElements.end(), faceElements.begin() + faceElementOffsets[chunk]);
+        chunkParser.clear();
+    });
+
+    return true;
+}
+
+bool OBJParser::parseChunk(const char* data, size_t length)
+{
+    reserveFromLineCounts(data, length);
+
+    const char* cursor = data;
+    const char* end = data + length;
+    float values[3];
+
+    while(cursor < end)
+    {
+        cursor = skipSpaces(cursor, end);
+        if(isLineEnd(cursor, end) || end - cursor < 2)
+        {
+            cursor = skipLine(cursor, end);
+            continue;
+        }
+
+        if(cursor[0] == 'v' && (cursor[1] == ' ' || cursor[1] == '\t'))
+        {
+            cursor += 1;
+            if(!parseFloats(cursor, end, values, 3))
+            {
+                errorMessage = "File contains malformed vertex data";
+                return false;
+            }
+            positions.insert(positions.end(), values, values + 3);
+        }
+        else if(cursor[0] == 'v' && cursor[1] == 't')
+        {
+            cursor += 2;
+            if(!parseFloats(cursor, end, values, 2))
+            {
+                errorMessage = "File contains malformed texture coordinate data";
+                return false;
+            }
+            textureCoordinates.insert(textureCoordinates.end(), values, values + 2);
+        }
+        else if(cursor[0] == 'v' && cursor[1] == 'n')
+        {
+            cursor += 2;
+            if(!parseFloats(cursor, end, values, 3))
+            {
+                errorMessage = "File contains malformed normal data";
+                return false;
+            }
+            normals.insert(normals.end(), values, values + 3);
+        }
+        else if(cursor[0] == 'f' && (cursor[1] == ' ' || cursor[1] == '\t'))
+        {
+            cursor += 1;
+
+            GLuint element[3];
+            for(int elementIndex = 0; elementIndex < 3; elementIndex++)
+            {
+                cursor = skipSpaces(cursor, end);
+                if(!parseFaceElement(cursor, end, element))
+                {
+                    errorMessage = "File contains invalid face element";
+                    return false;
+                }
+                faceElements.insert(faceElements.end(), element, element + 3);
+            }
+
+            cursor = skipSpaces(cursor, end);
+            if(!isLineEnd(cursor, end))
+            {
+                errorMessage = "File contains non-triangulated faces";
+                return false;
+            }
+        }
+
+        cursor = skipLine(cursor, end);
+    }
+
+    return true;
+}
+
+vector<float>& OBJParser::getPositions()
+{
+    return positions;
+}
+
+vector<float>& OBJParser::getTextureCoordinates()
+{
+    return textureCoordinates;
+}
+
+vector<float>& OBJParser::getNormals()
+{
+    return normals;
+}
+
+vector<GLuint>& OBJParser::getFaceElements()
+{
+    return faceElements;
+}
+
+string OBJParser::getError()
+{
+    return errorMessage;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "threadpool.h"
+
+#include <GL/glew.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+class OBJParser
+{
+    public:
+        OBJParser();
+
+        bool parse(const char* data, size_t length, ThreadPool* pool = NULL);
+        void clear();
+
+        vector<float>& getPositions();
+        vector<float>& getTextureCoordinates();
+        vector<float>& getNormals();
+        vector<GLuint>& getFaceElements();
+
+        string getError();
+
+    private:
+        vector<float> positions;
+        vector<float> textureCoordinates;
+        vector<float> normals;
+        vector<GLuint> faceElements;
+
+        string errorMessage;
+
+        bool parseChunk(const char* data, size_t length);
+        bool parseChunks(const char* data, size_t length, ThreadPool* pool);
+
+        void reserveFromLineCounts(const char* data, size_t length);
+        bool parseFloats(const char*& cursor, const char* end, float* values, int count);
+        bool parseFaceElement(const char*& cursor, const char* end, GLuint* element);
+};
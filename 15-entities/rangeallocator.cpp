@@ -0,0 +1,106 @@
+#include "rangeallocator.h"
+
+RangeAllocator::RangeAllocator()
+{
+    capacity = 0;
+    used = 0;
+}
+
+void RangeAllocator::init(size_t newCapacity)
+{
+    capacity = newCapacity;
+    used = 0;
+
+    freeRanges.clear();
+    if(capacity > 0)
+    {
+        freeRanges[0] = capacity;
+    }
+}
+
+bool RangeAllocator::allocate(size_t size, size_t& offset)
+{
+    if(size == 0)
+    {
+        offset = 0;
+        return true;
+    }
+
+    // First fit keeps long-lived allocations packed towards the start
+    for(auto range = freeRanges.begin(); range != freeRanges.end(); range++)
+    {
+        if(range->second < size)
+            continue;
+
+        offset = range->first;
+        size_t remaining = range->second - size;
+        freeRanges.erase(range);
+
+        if(remaining > 0)
+        {
+            freeRanges[offset + size] = remaining;
+        }
+
+        used += size;
+        return true;
+    }
+
+    return false;
+}
+
+void RangeAllocator::free(size_t offset, size_t size)
+{
+    if(size == 0)
+        return;
+
+    used -= size;
+
+    auto next = freeRanges.lower_bound(offset);
+    if(next != freeRanges.begin())
+    {
+        auto previous = next;
+        previous--;
+        if(previous->first + previous->second == offset)
+        {
+            offset = previous->first;
+            size += previous->second;
+            freeRanges.erase(previous);
+        }
+    }
+
+    if(next != freeRanges.end() && offset + size == next->first)
+    {
+        size += next->second;
+        freeRanges.erase(next);
+    }
+
+    freeRanges[offset] = size;
+}
+
+size_t RangeAllocator::getCapacity()
+{
+    return capacity;
+}
+
+size_t RangeAllocator::getUsed()
+{
+    return used;
+}
+
+size_t RangeAllocator::getLargestFreeRange()
+{
+    size_t largest = 0;
+    for(auto& range : freeRanges)
+    {
+        if(range.second > largest)
+        {
+            largest = range.second;
+        }
+    }
+    return largest;
+}
+
+int RangeAllocator::getFreeRangeCount()
+{
+    return freeRanges.size();
+}
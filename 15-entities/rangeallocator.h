@@ -0,0 +1,29 @@
+#pragma once
+
+#include <map>
+#include <stddef.h>
+
+using namespace std;
+
+class RangeAllocator
+{
+    public:
+        RangeAllocator();
+
+        void init(size_t newCapacity);
+        bool allocate(size_t size, size_t& offset);
+        void free(size_t offset, size_t size);
+
+        size_t getCapacity();
+        size_t getUsed();
+        size_t getLargestFreeRange();
+        int getFreeRangeCount();
+
+    private:
+        size_t capacity;
+        size_t used;
+
+        // Free ranges keyed by offset, so neighbours are found in order
+        // when a range is returned and can be merged back together
+        map<size_t, size_t> freeRanges;
+};
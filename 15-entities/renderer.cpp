@@ -0,0 +1,263 @@
+#include "renderer.h"
+
+#include <algorithm>
+
+Renderer::Renderer()
+{
+    matrixBuffer = 0;
+    drawDataBuffer = 0;
+    commandBuffer = 0;
+    matrixCapacity = 0;
+    drawDataCapacity = 0;
+    commandCapacity = 0;
+    screenScale = 1.0f;
+    drawCount = 0;
+    instanceCount = 0;
+}
+
+void Renderer::deleteRenderer()
+{
+    GLuint buffers[] = {matrixBuffer, drawDataBuffer, commandBuffer};
+    glDeleteBuffers(3, buffers);
+
+    matrixBuffer = 0;
+    drawDataBuffer = 0;
+    commandBuffer = 0;
+    matrixCapacity = 0;
+    drawDataCapacity = 0;
+    commandCapacity = 0;
+}
+
+void Renderer::begin(glm::mat4 newPvMatrix, glm::vec3 newCameraPosition, float newScreenScale)
+{
+    pvMatrix = newPvMatrix;
+    cameraPosition = newCameraPosition;
+    screenScale = newScreenScale;
+
+    // World space frustum planes from the rows of the combined matrix
+    glm::mat4 m = pvMatrix;
+    for(int i = 0; i < 3; i++)
+    {
+        glm::vec4 row = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+        glm::vec4 w = glm::vec4(m[0][3], m[1][3], m[2][3], m[3][3]);
+        frustumPlanes[i * 2] = w + row;
+        frustumPlanes[i * 2 + 1] = w - row;
+    }
+    for(int i = 0; i < 6; i++)
+    {
+        frustumPlanes[i] = frustumPlanes[i] / glm::length(glm::vec3(frustumPlanes[i]));
+    }
+
+    items.clear();
+    drawCount = 0;
+    instanceCount = 0;
+}
+
+void Renderer::submit(Entity* entity)
+{
+    if(!entity->prepareDraw(frustumPlanes, cameraPosition, screenScale))
+        return;
+
+    RenderItem item = {entity->getModel(), entity->getTexture(), entity->getLod(), entity};
+    items.push_back(item);
+}
+
+static bool sameGroup(const RenderItem& a, const RenderItem& b)
+{
+    return a.model == b.model && a.texture == b.texture && a.lod == b.lod;
+}
+
+// Pooled models on the same page share a vertex array, while a model with
+// its own buffers can only share a bucket with itself
+static bool sameBucket(const RenderItem& a, const RenderItem& b)
+{
+    if(a.model->getPoolPage() != b.model->getPoolPage())
+        return false;
+    if(a.model->getPoolPage() < 0 && a.model != b.model)
+        return false;
+
+    return a.model->getIndexType() == b.model->getIndexType() && a.texture == b.texture;
+}
+
+// Buffers are created on first use. Immutable storage cannot grow, so a
+// larger buffer replaces one that is too small.
+static void uploadToBuffer(GLuint& buffer, GLsizeiptr& capacity, const void* data, GLsizeiptr size)
+{
+    if(size > capacity)
+    {
+        GLsizeiptr newCapacity = capacity > 0 ? capacity : 4096;
+        while(newCapacity < size)
+        {
+            newCapacity *= 2;
+        }
+
+        glDeleteBuffers(1, &buffer);
+        glCreateBuffers(1, &buffer);
+        glNamedBufferStorage(buffer, newCapacity, NULL, GL_DYNAMIC_STORAGE_BIT);
+        capacity = newCapacity;
+    }
+
+    glNamedBufferSubData(buffer, 0, size, data);
+}
+
+// Draws everything submitted since begin(). The shader must be bound.
+void Renderer::end()
+{
+    // Sorting by page first puts models with their own vertex arrays ahead
+    // of the pool's, so the pool's record of its bound array stays valid
+    sort(items.begin(), items.end(), [](const RenderItem& a, const RenderItem& b)
+    {
+        if(a.model->getPoolPage() != b.model->getPoolPage())
+            return a.model->getPoolPage() < b.model->getPoolPage();
+        if(a.model->getIndexType() != b.model->getIndexType())
+            return a.model->getIndexType() < b.model->getIndexType();
+        if(a.texture != b.texture)
+            return less<Texture*>()(a.texture, b.texture);
+        if(a.model != b.model)
+            return less<Model*>()(a.model, b.model);
+        return a.lod < b.lod;
+    });
+
+    buildCommands();
+    drawBuckets();
+}
+
+void Renderer::buildCommands()
+{
+    matrices.clear();
+    commands.clear();
+    drawData.clear();
+    buckets.clear();
+
+    for(int i = 0; i < (int) items.size(); i++)
+    {
+        matrices.push_back(items[i].entity->getModelMatrix());
+    }
+
+    int first = 0;
+    while(first < (int) items.size())
+    {
+        int count = 1;
+        while(first + count < (int) items.size() && sameGroup(items[first], items[first + count]))
+        {
+            count++;
+        }
+
+        if(buckets.empty() || !sameBucket(items[buckets.back().item], items[first]))
+        {
+            RenderBucket bucket = {(int) commands.size(), 0, first};
+            buckets.push_back(bucket);
+        }
+
+        addCommands(first, count);
+        buckets.back().commandCount = commands.size() - buckets.back().firstCommand;
+        first += count;
+    }
+}
+
+void Renderer::addCommands(int first, int count)
+{
+    RenderItem& item = items[first];
+    Model* model = item.model;
+    int firstCommand = commands.size();
+
+    // A lone instance keeps the finer meshlet culling
+    if(count == 1 && item.lod == 0 && model->getMeshletCount() > 0)
+    {
+        item.entity->addMeshletCommands(pvMatrix, cameraPosition, first, commands);
+    }
+    else
+    {
+        for(int i = first; i < first + count; i++)
+        {
+            items[i].entity->countDrawnTriangles();
+        }
+
+        GLuint firstIndex = (uintptr_t) model->getLodIndexOffset(item.lod) / model->getIndexSize();
+        DrawElementsIndirectCommand command = {(GLuint) model->getLodIndexCount(item.lod), (GLuint) count, firstIndex, model->getBaseVertex(), (GLuint) first};
+        commands.push_back(command);
+    }
+
+    VertexQuantization quantization = model->getQuantization();
+    DrawData data = DrawData();
+    data.positionScale = glm::vec4(quantization.positionScale[0], quantization.positionScale[1], quantization.positionScale[2], 0.0f);
+    data.positionOffset = glm::vec4(quantization.positionOffset[0], quantization.positionOffset[1], quantization.positionOffset[2], 0.0f);
+    data.textureScaleOffset = glm::vec4(quantization.textureScale[0], quantization.textureScale[1], quantization.textureOffset[0], quantization.textureOffset[1]);
+    data.octahedralNormals = model->getVertexFormat().getLayout() == VERTEX_LAYOUT_COMPRESSED;
+
+    for(int i = firstCommand; i < (int) commands.size(); i++)
+    {
+        drawData.push_back(data);
+    }
+    instanceCount += count;
+}
+
+void Renderer::drawBuckets()
+{
+    if(commands.empty())
+        return;
+
+    uploadToBuffer(matrixBuffer, matrixCapacity, matrices.data(), matrices.size() * sizeof(glm::mat4));
+    uploadToBuffer(drawDataBuffer, drawDataCapacity, drawData.data(), drawData.size() * sizeof(DrawData));
+    uploadToBuffer(commandBuffer, commandCapacity, commands.data(), commands.size() * sizeof(DrawElementsIndirectCommand));
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, matrixBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, drawDataBuffer);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+    glActiveTexture(GL_TEXTURE0);
+
+    Texture* boundTexture = NULL;
+    Model* boundModel = NULL;
+    for(RenderBucket& bucket : buckets)
+    {
+        if(bucket.commandCount == 0)
+            continue;
+
+        RenderItem& item = items[bucket.item];
+        if(item.texture != boundTexture)
+        {
+            item.texture->bind();
+            boundTexture = item.texture;
+        }
+        if(boundModel != NULL && boundModel->getPoolPage() < 0)
+        {
+            boundModel->unbind();
+        }
+        item.model->bind();
+        boundModel = item.model;
+
+        // gl_DrawID restarts at zero for every multi-draw
+        glUniform1i(2, bucket.firstCommand);
+
+        const void* offset = (const void*) (bucket.firstCommand * sizeof(DrawElementsIndirectCommand));
+        glMultiDrawElementsIndirect(GL_TRIANGLES, item.model->getIndexType(), offset, bucket.commandCount, 0);
+        drawCount++;
+    }
+
+    if(boundModel != NULL)
+    {
+        boundModel->unbind();
+    }
+    if(boundTexture != NULL)
+    {
+        boundTexture->unbind();
+    }
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, 0);
+}
+
+int Renderer::getDrawCount()
+{
+    return drawCount;
+}
+
+int Renderer::getCommandCount()
+{
+    return commands.size();
+}
+
+int Renderer::getInstanceCount()
+{
+    return instanceCount;
+}
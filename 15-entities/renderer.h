@@ -0,0 +1,84 @@
+#pragma once
+
+#include "entity.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+using namespace std;
+
+struct RenderItem
+{
+    Model* model;
+    Texture* texture;
+    int lod;
+    Entity* entity;
+};
+
+// Per-draw data read by the vertex shader through gl_DrawID, laid out to
+// match the std430 DrawData struct
+struct DrawData
+{
+    glm::vec4 positionScale;
+    glm::vec4 positionOffset;
+    glm::vec4 textureScaleOffset;
+    GLint octahedralNormals;
+    GLint padding[3];
+};
+
+// A run of draw commands sharing a vertex array, index type and texture,
+// which are submitted with one glMultiDrawElementsIndirect call
+struct RenderBucket
+{
+    int firstCommand;
+    int commandCount;
+    int item;
+};
+
+// Collects the entities drawn in a frame and draws them with one
+// multi-draw per bucket. Each group of entities sharing a model, texture
+// and level of detail becomes one instanced draw command. Model matrices
+// for the whole frame go into one storage buffer, which each instance
+// indexes with gl_BaseInstance + gl_InstanceID.
+class Renderer
+{
+    public:
+        Renderer();
+
+        void deleteRenderer();
+
+        void begin(glm::mat4 newPvMatrix, glm::vec3 newCameraPosition, float newScreenScale);
+        void submit(Entity* entity);
+        void end();
+
+        int getDrawCount();
+        int getCommandCount();
+        int getInstanceCount();
+
+    private:
+        GLuint matrixBuffer;
+        GLuint drawDataBuffer;
+        GLuint commandBuffer;
+        GLsizeiptr matrixCapacity;
+        GLsizeiptr drawDataCapacity;
+        GLsizeiptr commandCapacity;
+
+        glm::mat4 pvMatrix;
+        glm::vec3 cameraPosition;
+        float screenScale;
+        glm::vec4 frustumPlanes[6];
+
+        vector<RenderItem> items;
+        vector<glm::mat4> matrices;
+        vector<DrawElementsIndirectCommand> commands;
+        vector<DrawData> drawData;
+        vector<RenderBucket> buckets;
+
+        int drawCount;
+        int instanceCount;
+
+        void buildCommands();
+        void addCommands(int first, int count);
+        void drawBuckets();
+};
@@ -1,6 +1,5 @@
 #include "shader.h"
-#include <fstream>
-#include <sstream>
+#include "trace.h"
 
 Shader::Shader()
 {
@@ -13,38 +12,26 @@ void Shader::setFilenames(string newVertexFilename, string newFragmentFilename)
     fragmentFilename = SDL_GetBasePath() + newFragmentFilename;
 }
 
-string Shader::readFile(string filename)
+bool Shader::readFile(string filename, FileView& file)
 {
-    ifstream file(filename);
-    if(!file.is_open())
+    if(!file.open(filename))
     {
-        errorMessage += "Cannot open file: ";
-        errorMessage += filename;
-        return "";
+        errorMessage += file.getError();
+        return false;
     }
 
-    stringstream buffer;
-    buffer << file.rdbuf();
-    string contents = buffer.str();
-    file.close();
-
-    if(contents.empty())
+    if(file.getSize() == 0)
     {
         errorMessage += "Shader source file is empty: ";
         errorMessage += filename;
+        return false;
     }
 
-    return contents;
+    return true;
 }
 
-GLuint Shader::createShader(string filename, GLenum shaderType)
+GLuint Shader::createShader(FileView& shaderSource, GLenum shaderType)
 {
-    string shaderSource = readFile(filename);
-    if(shaderSource.empty())
-    {
-        return 0;
-    }
-
     GLuint shader = glCreateShader(shaderType);
     if(shader == 0)
     {
@@ -52,8 +39,9 @@ GLuint Shader::createShader(string filename, GLenum shaderType)
         return 0;
     }
 
-    const char* shaderText = shaderSource.c_str();
-    glShaderSource(shader, 1, &shaderText, NULL);
+    const char* shaderText = shaderSource.getData();
+    GLint shaderLength = shaderSource.getSize();
+    glShaderSource(shader, 1, &shaderText, &shaderLength);
     glCompileShader(shader);
     
     GLint compileStatus;
@@ -79,31 +67,71 @@ GLuint Shader::createShader(string filename, GLenum shaderType)
 }
 
 bool Shader::loadShader()
+{
+    return prepareShader() && uploadShader();
+}
+
+// Reads the source files without touching OpenGL, so this can run on a
+// worker thread
+bool Shader::prepareShader()
 {
     errorMessage = "";
-    deleteShader();
+    LoadStatistics::begin(loadRecord, "shader", getFilenames());
+    TRACE_ZONE_DETAIL("prepareShader", loadRecord.name.c_str());
+    loadTimer.start();
 
     if(vertexFilename.empty() || fragmentFilename.empty())
     {
         errorMessage = "Shader source filenames not set";
+        LoadStatistics::add(loadRecord, false);
         return false;
     }
 
-    GLuint vertexShader = createShader(vertexFilename, GL_VERTEX_SHADER);
-    if(vertexShader == 0)
+    if(!readFile(vertexFilename, vertexSource) || !readFile(fragmentFilename, fragmentSource))
     {
+        vertexSource.close();
+        fragmentSource.close();
+        LoadStatistics::add(loadRecord, false);
         return false;
     }
 
-    GLuint fragmentShader = createShader(fragmentFilename, GL_FRAGMENT_SHADER);
-    if(fragmentShader == 0)
+    loadRecord.bytesRead = vertexSource.getSize() + fragmentSource.getSize();
+    loadTimer.endPhase(loadRecord, LOAD_PHASE_READ);
+
+    return true;
+}
+
+// Compiles the prepared sources on the GL thread. The current program is
+// only replaced once the new one has linked. Compiling and linking are
+// counted as the upload phase.
+bool Shader::uploadShader()
+{
+    TRACE_ZONE_DETAIL("uploadShader", loadRecord.name.c_str());
+
+    loadTimer.start();
+    bool linked = linkProgram();
+    loadTimer.endPhase(loadRecord, LOAD_PHASE_UPLOAD);
+    LoadStatistics::add(loadRecord, linked);
+
+    return linked;
+}
+
+bool Shader::linkProgram()
+{
+    GLuint vertexShader = createShader(vertexSource, GL_VERTEX_SHADER);
+    GLuint fragmentShader = vertexShader != 0 ? createShader(fragmentSource, GL_FRAGMENT_SHADER) : 0;
+
+    vertexSource.close();
+    fragmentSource.close();
+
+    if(vertexShader == 0 || fragmentShader == 0)
     {
         glDeleteShader(vertexShader);
         return false;
     }
 
-    shaderProgram = glCreateProgram();
-    if(shaderProgram == 0)
+    GLuint program = glCreateProgram();
+    if(program == 0)
     {
         glDeleteShader(vertexShader);
         glDeleteShader(fragmentShader);
@@ -111,35 +139,38 @@ bool Shader::loadShader()
         return false;
     }
 
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
 
-    glLinkProgram(shaderProgram);
+    glLinkProgram(program);
     
-    glDetachShader(shaderProgram, vertexShader);
+    glDetachShader(program, vertexShader);
     glDeleteShader(vertexShader);
-    glDetachShader(shaderProgram, fragmentShader);
+    glDetachShader(program, fragmentShader);
     glDeleteShader(fragmentShader);
 
     GLint linkStatus;
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &linkStatus);
+    glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
     if(linkStatus == GL_FALSE)
     {
         GLint logLength;
-        glGetProgramiv(shaderProgram, GL_INFO_LOG_LENGTH , &logLength);
+        glGetProgramiv(program, GL_INFO_LOG_LENGTH , &logLength);
 
         GLchar* compilerLog = new GLchar[logLength];
-        glGetProgramInfoLog(shaderProgram, logLength, NULL, compilerLog);
+        glGetProgramInfoLog(program, logLength, NULL, compilerLog);
 
         errorMessage = "Error linking shader program: ";
         errorMessage += compilerLog;
         delete[] compilerLog;
 
-        deleteShader();
+        glDeleteProgram(program);
 
         return false;
     }
 
+    deleteShader();
+    shaderProgram = program;
+
     return true;
 }
 
@@ -170,7 +201,17 @@ string Shader::getError()
     return errorMessage;
 }
 
+bool Shader::isLoaded()
+{
+    return shaderProgram != 0;
+}
+
 GLuint Shader::getHandle()
 {
     return shaderProgram;
 }
+
+LoadRecord Shader::getLoadRecord()
+{
+    return loadRecord;
+}
@@ -1,5 +1,8 @@
 #pragma once
 
+#include "fileview.h"
+#include "loadstatistics.h"
+
 #include <SDL3/SDL.h>
 #include <GL/glew.h>
 #include <string>
@@ -13,6 +16,8 @@ class Shader
 
         void setFilenames(string newVertexFilename, string newFragmentFilename);
         bool loadShader();
+        bool prepareShader();
+        bool uploadShader();
         void deleteShader();
 
         void bind();
@@ -20,13 +25,23 @@ class Shader
 
         string getFilenames();
         string getError();
+        bool isLoaded();
         GLuint getHandle();
+        LoadRecord getLoadRecord();
 
     private:
         string vertexFilename, fragmentFilename;
         string errorMessage;
         GLuint shaderProgram;
 
-        GLuint createShader(string filename, GLenum shaderType);
-        string readFile(string filename);
+        FileView vertexSource;
+        FileView fragmentSource;
+
+        LoadRecord loadRecord;
+        LoadTimer loadTimer;
+
+        bool linkProgram();
+
+        GLuint createShader(FileView& shaderSource, GLenum shaderType);
+        bool readFile(string filename, FileView& file);
 };
@@ -1,12 +1,23 @@
-#version 460
+#version 450
 
+layout(location = 3) uniform int uShowNormals;
 layout(binding = 0) uniform sampler2D uTexture;
 
 in vec2 textureCoordinate;
+in vec3 normal;
 
 out vec4 fragment;
 
 void main()
 {
-    fragment = texture(uTexture, textureCoordinate);
+    // The normal view maps each axis to a colour channel, which shows
+    // whether compressed normals decode the same as full precision ones
+    if(uShowNormals != 0)
+    {
+        fragment = vec4(normalize(normal) * 0.5 + 0.5, 1.0);
+    }
+    else
+    {
+        fragment = texture(uTexture, textureCoordinate);
+    }
 }
@@ -1,17 +1,53 @@
-#version 460
+#version 450
+#extension GL_ARB_shader_draw_parameters : require
 
 layout(location = 0) uniform mat4 uPMatrix;
 layout(location = 1) uniform mat4 uVMatrix;
-layout(location = 2) uniform mat4 uMMatrix;
+layout(location = 2) uniform int uDrawOffset;
+
+struct DrawData
+{
+    vec4 positionScale;
+    vec4 positionOffset;
+    vec4 textureScaleOffset;
+    int octahedralNormals;
+};
+
+layout(std430, binding = 0) readonly buffer ModelMatrices
+{
+    mat4 modelMatrices[];
+};
+
+layout(std430, binding = 1) readonly buffer Draws
+{
+    DrawData draws[];
+};
 
 layout(location = 0) in vec3 aPosition;
 layout(location = 1) in vec3 aNormal;
 layout(location = 2) in vec2 aTextureCoordinate;
 
 out vec2 textureCoordinate;
+out vec3 normal;
+
+vec3 decodeOctahedral(vec2 encoded)
+{
+    vec3 decoded = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    if(decoded.z < 0.0)
+    {
+        vec2 signs = vec2(encoded.x < 0.0 ? -1.0 : 1.0, encoded.y < 0.0 ? -1.0 : 1.0);
+        decoded.xy = (1.0 - abs(encoded.yx)) * signs;
+    }
+    return normalize(decoded);
+}
 
 void main()
 {
-    textureCoordinate = aTextureCoordinate;
-    gl_Position = uPMatrix * uVMatrix * uMMatrix * vec4(aPosition, 1.0);
+    DrawData draw = draws[uDrawOffset + gl_DrawIDARB];
+    vec3 position = aPosition * draw.positionScale.xyz + draw.positionOffset.xyz;
+
+    normal = draw.octahedralNormals != 0 ? decodeOctahedral(aNormal.xy) : aNormal;
+    textureCoordinate = aTextureCoordinate * draw.textureScaleOffset.xy + draw.textureScaleOffset.zw;
+    mat4 modelMatrix = modelMatrices[gl_BaseInstanceARB + gl_InstanceID];
+    gl_Position = uPMatrix * uVMatrix * modelMatrix * vec4(position, 1.0);
 }
@@ -0,0 +1,252 @@
+#include "stagingbuffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+static const GLbitfield stagingFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+StagingBuffer::StagingBuffer()
+{
+    bufferHandle = 0;
+    mappedData = NULL;
+    capacity = 0;
+
+    head = 0;
+    tail = 0;
+    unfencedBytes = 0;
+
+    frameBudget = 0;
+    bytesThisFrame = 0;
+}
+
+bool StagingBuffer::create(GLsizeiptr size)
+{
+    deleteBuffer();
+
+    glCreateBuffers(1, &bufferHandle);
+    glNamedBufferStorage(bufferHandle, size, NULL, stagingFlags);
+
+    // The buffer stays mapped for its whole life, and coherent mapping means
+    // writes are visible to copies issued afterwards without any flushing
+    mappedData = (unsigned char*) glMapNamedBufferRange(bufferHandle, 0, size, stagingFlags);
+
+    if(mappedData == NULL)
+    {
+        errorMessage = "Unable to map staging buffer";
+        deleteBuffer();
+        return false;
+    }
+
+    capacity = size;
+    return true;
+}
+
+void StagingBuffer::deleteBuffer()
+{
+    retireFences(false);
+    while(!fences.empty())
+    {
+        retireFences(true);
+    }
+
+    if(mappedData != NULL)
+    {
+        glUnmapNamedBuffer(bufferHandle);
+    }
+
+    glDeleteBuffers(1, &bufferHandle);
+    bufferHandle = 0;
+    mappedData = NULL;
+    capacity = 0;
+
+    head = 0;
+    tail = 0;
+    unfencedBytes = 0;
+}
+
+void StagingBuffer::setFrameBudget(GLsizeiptr bytes)
+{
+    frameBudget = bytes;
+}
+
+void StagingBuffer::beginFrame()
+{
+    bytesThisFrame = 0;
+    retireFences(false);
+}
+
+// A budget of zero means uploads are never held back
+bool StagingBuffer::hasBudget()
+{
+    return frameBudget == 0 || bytesThisFrame < frameBudget;
+}
+
+GLsizeiptr StagingBuffer::getBytesThisFrame()
+{
+    return bytesThisFrame;
+}
+
+bool StagingBuffer::copyToBuffer(GLuint buffer, GLintptr destinationOffset, const void* data, GLsizeiptr size)
+{
+    if(mappedData == NULL)
+        return false;
+
+    // Copy in pieces of at most half the ring, so the next piece can be
+    // written while the GPU is still reading the previous one
+    GLsizeiptr chunkSize = capacity / 2;
+
+    for(GLsizeiptr copied = 0; copied < size; copied += chunkSize)
+    {
+        GLsizeiptr chunk = min(chunkSize, size - copied);
+
+        GLintptr offset;
+        reserve(chunk, offset);
+        memcpy(mappedData + offset, (const unsigned char*) data + copied, chunk);
+        glCopyNamedBufferSubData(bufferHandle, buffer, offset, destinationOffset + copied, chunk);
+    }
+
+    insertFence();
+    bytesThisFrame += size;
+
+    return true;
+}
+
+// Uploads level 0 of an RGBA8 texture through the ring as a pixel unpack
+// buffer, a band of rows at a time
+bool StagingBuffer::copyToTexture(GLuint texture, GLsizei width, GLsizei height, GLsizei pitch, const void* pixels)
+{
+    GLsizeiptr rowSize = (GLsizeiptr) width * 4;
+    GLsizei rowsPerChunk = capacity / 2 / rowSize;
+    if(mappedData == NULL || rowsPerChunk < 1)
+        return false;
+
+    // Pixel uploads can only source a buffer through the unpack binding
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, bufferHandle);
+
+    for(GLsizei row = 0; row < height; row += rowsPerChunk)
+    {
+        GLsizei rows = min(rowsPerChunk, height - row);
+
+        GLintptr offset;
+        reserve(rows * rowSize, offset);
+        for(GLsizei i = 0; i < rows; i++)
+        {
+            memcpy(mappedData + offset + i * rowSize, (const unsigned char*) pixels + (GLsizeiptr) (row + i) * pitch, rowSize);
+        }
+
+        glTextureSubImage2D(texture, 0, 0, row, width, rows, GL_RGBA, GL_UNSIGNED_BYTE, (const void*) offset);
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    insertFence();
+    bytesThisFrame += rowSize * height;
+
+    return true;
+}
+
+bool StagingBuffer::isCreated()
+{
+    return mappedData != NULL;
+}
+
+string StagingBuffer::getError()
+{
+    return errorMessage;
+}
+
+// Finds room for size bytes, waiting for the GPU to finish with older data
+// when the ring is full. Sizes must not exceed the capacity.
+bool StagingBuffer::reserve(GLsizeiptr size, GLintptr& offset)
+{
+    if(size > capacity)
+        return false;
+
+    retireFences(false);
+
+    while(true)
+    {
+        bool empty = fences.empty() && unfencedBytes == 0;
+        if(empty)
+        {
+            head = 0;
+            tail = 0;
+        }
+
+        // Keep every piece 4-byte aligned for the copy and unpack commands
+        GLintptr start = (head + 3) & ~(GLintptr) 3;
+        bool fits = false;
+
+        if(empty)
+        {
+            fits = true;
+        }
+        else if(head > tail)
+        {
+            if(start + size <= capacity)
+            {
+                fits = true;
+            }
+            else if(size <= tail)
+            {
+                start = 0;
+                fits = true;
+            }
+        }
+        else if(head < tail)
+        {
+            fits = start + size <= tail;
+        }
+
+        if(fits)
+        {
+            // Any bytes skipped at the end of the buffer count as used until
+            // the fence covering this piece is reached
+            GLsizeiptr used = start >= head ? start + size - head : capacity - head + size;
+            unfencedBytes += used;
+            head = start + size;
+            offset = start;
+            return true;
+        }
+
+        insertFence();
+        retireFences(true);
+    }
+}
+
+void StagingBuffer::insertFence()
+{
+    if(unfencedBytes == 0)
+        return;
+
+    StagingFence stagingFence = {glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), head};
+    fences.push_back(stagingFence);
+    unfencedBytes = 0;
+}
+
+void StagingBuffer::retireFences(bool waitForOldest)
+{
+    if(waitForOldest && !fences.empty())
+    {
+        GLenum result = GL_TIMEOUT_EXPIRED;
+        while(result == GL_TIMEOUT_EXPIRED)
+        {
+            result = glClientWaitSync(fences.front().fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        }
+
+        tail = fences.front().end;
+        glDeleteSync(fences.front().fence);
+        fences.pop_front();
+    }
+
+    while(!fences.empty())
+    {
+        GLenum result = glClientWaitSync(fences.front().fence, 0, 0);
+        if(result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+            break;
+
+        tail = fences.front().end;
+        glDeleteSync(fences.front().fence);
+        fences.pop_front();
+    }
+}
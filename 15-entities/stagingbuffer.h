@@ -0,0 +1,54 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <deque>
+#include <string>
+
+using namespace std;
+
+struct StagingFence
+{
+    GLsync fence;
+    GLintptr end;
+};
+
+class StagingBuffer
+{
+    public:
+        StagingBuffer();
+
+        bool create(GLsizeiptr size);
+        void deleteBuffer();
+
+        void setFrameBudget(GLsizeiptr bytes);
+        void beginFrame();
+        bool hasBudget();
+        GLsizeiptr getBytesThisFrame();
+
+        bool copyToBuffer(GLuint buffer, GLintptr destinationOffset, const void* data, GLsizeiptr size);
+        bool copyToTexture(GLuint texture, GLsizei width, GLsizei height, GLsizei pitch, const void* pixels);
+
+        bool isCreated();
+        string getError();
+
+    private:
+        GLuint bufferHandle;
+        unsigned char* mappedData;
+        GLsizeiptr capacity;
+
+        // Bytes [tail, head) are in use, wrapping around the end of the
+        // buffer. Each fence releases everything written before it.
+        GLintptr head;
+        GLintptr tail;
+        GLsizeiptr unfencedBytes;
+        deque<StagingFence> fences;
+
+        GLsizeiptr frameBudget;
+        GLsizeiptr bytesThisFrame;
+
+        string errorMessage;
+
+        bool reserve(GLsizeiptr size, GLintptr& offset);
+        void insertFence();
+        void retireFences(bool waitForOldest);
+};
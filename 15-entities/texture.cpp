@@ -1,14 +1,27 @@
 #include "texture.h"
+#include "fileview.h"
+#include "trace.h"
+
 #include <SDL3_image/SDL_image.h>
+#include <algorithm>
 
 Texture::Texture()
 {
     textureHandle = 0;
+    preparedSurface = NULL;
+    stagingBuffer = NULL;
 
     mipmapsEnabled = true;
     anisotropyFilters = 16;
 }
 
+// Only frees a surface that was prepared but never uploaded. The OpenGL
+// texture is freed by deleteTexture(), on the thread with the context.
+Texture::~Texture()
+{
+    SDL_DestroySurface(preparedSurface);
+}
+
 void Texture::setFilename(string newTextureFilename)
 {
     filename = SDL_GetBasePath() + newTextureFilename;
@@ -16,7 +29,31 @@ void Texture::setFilename(string newTextureFilename)
 
 bool Texture::loadTexture()
 {
-    deleteTexture();
+    return prepareTexture() && uploadTexture();
+}
+
+// Decodes the image into an RGBA surface without touching OpenGL, so this
+// can run on a worker thread
+bool Texture::prepareTexture()
+{
+    LoadStatistics::begin(loadRecord, "texture", filename);
+    TRACE_ZONE_DETAIL("prepareTexture", loadRecord.name.c_str());
+    loadTimer.start();
+
+    bool ready = decodeTexture();
+    if(!ready)
+    {
+        LoadStatistics::add(loadRecord, false);
+    }
+
+    return ready;
+}
+
+bool Texture::decodeTexture()
+{
+    errorMessage = "";
+    SDL_DestroySurface(preparedSurface);
+    preparedSurface = NULL;
 
     if(filename.empty())
     {
@@ -24,13 +61,23 @@ bool Texture::loadTexture()
         return false;
     }
 
-    SDL_Surface* surface = IMG_Load(filename.c_str());
+    FileView file;
+    if(!file.open(filename))
+    {
+        errorMessage = file.getError();
+        return false;
+    }
+    loadRecord.bytesRead = file.getSize();
+    loadTimer.endPhase(loadRecord, LOAD_PHASE_READ);
+
+    SDL_Surface* surface = IMG_Load_IO(SDL_IOFromConstMem(file.getData(), file.getSize()), true);
     if(!surface)
     {
         errorMessage = "Unable to load image: ";
         errorMessage += filename;
         return false;
     }
+    loadTimer.endPhase(loadRecord, LOAD_PHASE_PARSE);
 
     Uint32 rmask, gmask, bmask, amask;
     if(SDL_BYTEORDER == SDL_BIG_ENDIAN)
@@ -72,23 +119,70 @@ bool Texture::loadTexture()
         return false;
     }
 
-    glGenTextures(1, &textureHandle);
-    glBindTexture(GL_TEXTURE_2D, textureHandle);
+    SDL_DestroySurface(surface);
+    preparedSurface = surfaceRGBA;
+    loadTimer.endPhase(loadRecord, LOAD_PHASE_PROCESS);
 
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, surfaceRGBA->w, surfaceRGBA->h, 0, GL_RGBA, GL_UNSIGNED_BYTE, surfaceRGBA->pixels);
+    return true;
+}
 
+// Uploads the prepared surface on the GL thread, replacing any texture
+// that was loaded before
+bool Texture::uploadTexture()
+{
+    TRACE_ZONE_DETAIL("uploadTexture", loadRecord.name.c_str());
+
+    if(preparedSurface == NULL)
+    {
+        errorMessage = "Texture has not been prepared: ";
+        errorMessage += filename;
+        return false;
+    }
+
+    loadTimer.start();
+    deleteTexture();
+
+    int width = preparedSurface->w;
+    int height = preparedSurface->h;
+
+    // Every level is allocated up front, as the storage cannot be resized
+    GLsizei levels = 1;
     if(mipmapsEnabled)
     {
-        glGenerateMipmap(GL_TEXTURE_2D);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        for(int size = max(width, height); size > 1; size /= 2)
+        {
+            levels++;
+        }
+    }
+
+    glCreateTextures(GL_TEXTURE_2D, 1, &textureHandle);
+    glTextureStorage2D(textureHandle, levels, GL_RGBA8, width, height);
+
+    // Stream the pixels through the staging ring, falling back to a direct
+    // upload if the rows do not fit in it
+    bool staged = false;
+    if(stagingBuffer != NULL && stagingBuffer->isCreated())
+    {
+        staged = stagingBuffer->copyToTexture(textureHandle, width, height, preparedSurface->pitch, preparedSurface->pixels);
+    }
+
+    if(!staged)
+    {
+        glTextureSubImage2D(textureHandle, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, preparedSurface->pixels);
+    }
+
+    if(mipmapsEnabled)
+    {
+        glGenerateTextureMipmap(textureHandle);
+        glTextureParameteri(textureHandle, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     }
     else
     {
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTextureParameteri(textureHandle, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     }
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTextureParameteri(textureHandle, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-    GLint maxAnisotropyFilters;
+    GLint maxAnisotropyFilters = 1;
     glGetIntegerv(GL_MAX_TEXTURE_MAX_ANISOTROPY, &maxAnisotropyFilters);
 
     if(anisotropyFilters > maxAnisotropyFilters)
@@ -96,12 +190,14 @@ bool Texture::loadTexture()
         anisotropyFilters = maxAnisotropyFilters;
     }
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY, anisotropyFilters);
+    glTextureParameteri(textureHandle, GL_TEXTURE_MAX_ANISOTROPY, anisotropyFilters);
 
-    SDL_DestroySurface(surfaceRGBA);
-    SDL_DestroySurface(surface);
+    SDL_DestroySurface(preparedSurface);
+    preparedSurface = NULL;
 
-    unbind();
+    loadRecord.bytesUploaded = (size_t) width * height * 4;
+    loadTimer.endPhase(loadRecord, LOAD_PHASE_UPLOAD);
+    LoadStatistics::add(loadRecord, true);
 
     return true;
 }
@@ -113,6 +209,11 @@ void Texture::deleteTexture()
     errorMessage = "";
 }
 
+void Texture::setStagingBuffer(StagingBuffer* newStagingBuffer)
+{
+    stagingBuffer = newStagingBuffer;
+}
+
 void Texture::setMipmaps(bool useMipmaps)
 {
     mipmapsEnabled = useMipmaps;
@@ -130,9 +231,7 @@ void Texture::setAnisotropyFilters(int filters)
 
 void Texture::setParameter(GLenum parameter, GLint value)
 {
-    bind();
-    glTexParameteri(GL_TEXTURE_2D, parameter, value);
-    unbind();
+    glTextureParameteri(textureHandle, parameter, value);
 }
 
 void Texture::bind()
@@ -145,6 +244,11 @@ void Texture::unbind()
     glBindTexture(GL_TEXTURE_2D, 0);
 }
 
+bool Texture::isLoaded()
+{
+    return textureHandle != 0;
+}
+
 GLuint Texture::getHandle()
 {
     return textureHandle;
@@ -159,3 +263,8 @@ string Texture::getError()
 {
     return errorMessage;
 }
+
+LoadRecord Texture::getLoadRecord()
+{
+    return loadRecord;
+}
@@ -1,5 +1,9 @@
 #pragma once
 
+#include "loadstatistics.h"
+#include "stagingbuffer.h"
+
+#include <SDL3/SDL.h>
 #include <GL/glew.h>
 #include <string>
 
@@ -9,11 +13,15 @@ class Texture
 {
     public:
         Texture();
+        ~Texture();
 
         void setFilename(string newTextureFilename);
         bool loadTexture();
+        bool prepareTexture();
+        bool uploadTexture();
         void deleteTexture();
 
+        void setStagingBuffer(StagingBuffer* newStagingBuffer);
         void setMipmaps(bool useMipmaps);
         void setAnisotropyFilters(int filters);
         void setParameter(GLenum parameter, int value);
@@ -21,9 +29,11 @@ class Texture
         void bind();
         void unbind();
         
+        bool isLoaded();
         GLuint getHandle();
         string getFilename();
         string getError();
+        LoadRecord getLoadRecord();
 
     private:
         string filename;
@@ -32,5 +42,12 @@ class Texture
         int anisotropyFilters;
 
         GLuint textureHandle;
+        SDL_Surface* preparedSurface;
+        StagingBuffer* stagingBuffer;
         string errorMessage;
+
+        LoadRecord loadRecord;
+        LoadTimer loadTimer;
+
+        bool decodeTexture();
 };
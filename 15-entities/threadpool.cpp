@@ -0,0 +1,138 @@
+#include "threadpool.h"
+#include "trace.h"
+
+#include <atomic>
+#include <memory>
+
+ThreadPool::ThreadPool()
+{
+    stopping = false;
+}
+
+ThreadPool::~ThreadPool()
+{
+    stop();
+}
+
+void ThreadPool::start(int threadCount)
+{
+    stop();
+
+    if(threadCount < 1)
+    {
+        threadCount = thread::hardware_concurrency();
+    }
+
+    stopping = false;
+    for(int i = 0; i < threadCount; i++)
+    {
+        workers.push_back(thread(&ThreadPool::workerLoop, this));
+    }
+}
+
+void ThreadPool::stop()
+{
+    {
+        lock_guard<mutex> lock(taskMutex);
+        stopping = true;
+    }
+    taskAvailable.notify_all();
+
+    for(int i = 0; i < (int) workers.size(); i++)
+    {
+        workers[i].join();
+    }
+    workers.clear();
+}
+
+void ThreadPool::workerLoop()
+{
+    TRACE_THREAD_NAME("worker");
+
+    while(true)
+    {
+        function<void()> task;
+        {
+            unique_lock<mutex> lock(taskMutex);
+            taskAvailable.wait(lock, [this] { return stopping || !tasks.empty(); });
+
+            if(tasks.empty())
+                return;
+
+            task = move(tasks.front());
+            tasks.pop_front();
+        }
+
+        TRACE_ZONE("task");
+        task();
+    }
+}
+
+void ThreadPool::submit(function<void()> task)
+{
+    if(workers.empty())
+    {
+        task();
+        return;
+    }
+
+    {
+        lock_guard<mutex> lock(taskMutex);
+        tasks.push_back(move(task));
+    }
+    taskAvailable.notify_one();
+}
+
+void ThreadPool::parallelFor(int count, function<void(int)> body)
+{
+    if(count <= 0)
+        return;
+
+    struct Batch
+    {
+        atomic<int> nextIndex;
+        atomic<int> completed;
+        mutex doneMutex;
+        condition_variable done;
+        function<void(int)> body;
+        int count;
+    };
+
+    shared_ptr<Batch> batch = make_shared<Batch>();
+    batch->nextIndex = 0;
+    batch->completed = 0;
+    batch->body = body;
+    batch->count = count;
+
+    // The calling thread takes indices too, so this never deadlocks when
+    // called from a task that is itself running on one of the workers
+    auto runIndices = [batch]()
+    {
+        int index;
+        while((index = batch->nextIndex++) < batch->count)
+        {
+            batch->body(index);
+            if(++batch->completed == batch->count)
+            {
+                lock_guard<mutex> lock(batch->doneMutex);
+                batch->done.notify_all();
+            }
+        }
+    };
+
+    int helpers = min(count - 1, (int) workers.size());
+    for(int i = 0; i < helpers; i++)
+    {
+        submit(runIndices);
+    }
+
+    runIndices();
+
+    unique_lock<mutex> lock(batch->doneMutex);
+    batch->done.wait(lock, [&batch] { return batch->completed == batch->count; });
+}
+
+int ThreadPool::getThreadCount()
+{
+    return workers.size();
+}
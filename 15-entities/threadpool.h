@@ -0,0 +1,35 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+class ThreadPool
+{
+    public:
+        ThreadPool();
+        ~ThreadPool();
+
+        void start(int threadCount);
+        void stop();
+
+        void submit(function<void()> task);
+        void parallelFor(int count, function<void(int)> body);
+
+        int getThreadCount();
+
+    private:
+        vector<thread> workers;
+        deque<function<void()>> tasks;
+
+        mutex taskMutex;
+        condition_variable taskAvailable;
+        bool stopping;
+
+        void workerLoop();
+};
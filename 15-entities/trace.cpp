@@ -0,0 +1,173 @@
+#include "trace.h"
+#include "jsonwriter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <stdio.h>
+#include <vector>
+
+// Each thread writes only to its own ring, so recording never takes a lock.
+// Rings are never freed, which keeps the events of finished threads around
+// for export.
+struct TraceBuffer
+{
+    int threadId;
+    string threadName;
+    vector<TraceEvent> events;
+    atomic<size_t> written;
+};
+
+static const size_t traceBufferEvents = 16384;
+
+static chrono::steady_clock::time_point traceStart = chrono::steady_clock::now();
+static mutex buffersMutex;
+static vector<TraceBuffer*> buffers;
+static thread_local TraceBuffer* threadBuffer = NULL;
+
+static TraceBuffer* getThreadBuffer()
+{
+    if(threadBuffer != NULL)
+        return threadBuffer;
+
+    TraceBuffer* buffer = new TraceBuffer();
+    buffer->events.resize(traceBufferEvents);
+    buffer->written = 0;
+
+    lock_guard<mutex> lock(buffersMutex);
+    buffer->threadId = buffers.size() + 1;
+    buffer->threadName = "thread " + to_string(buffer->threadId);
+    buffers.push_back(buffer);
+
+    threadBuffer = buffer;
+    return buffer;
+}
+
+bool Trace::isEnabled()
+{
+#ifdef ENABLE_TRACING
+    return true;
+#else
+    return false;
+#endif
+}
+
+void Trace::setThreadName(string name)
+{
+    TraceBuffer* buffer = getThreadBuffer();
+
+    lock_guard<mutex> lock(buffersMutex);
+    buffer->threadName = name;
+}
+
+void Trace::addEvent(const char* name, const char* detail, chrono::steady_clock::time_point start, chrono::steady_clock::time_point end)
+{
+    TraceBuffer* buffer = getThreadBuffer();
+    size_t index = buffer->written.load(memory_order_relaxed);
+
+    TraceEvent& event = buffer->events[index % traceBufferEvents];
+    event.name = name;
+
+    // Long details keep their end, which for a path is the file name
+    event.detail[0] = '\0';
+    if(detail != NULL)
+    {
+        size_t length = strlen(detail);
+        size_t capacity = sizeof(event.detail) - 1;
+        strncat(event.detail, length > capacity ? detail + length - capacity : detail, capacity);
+    }
+    event.start = start;
+    event.end = end;
+
+    buffer->written.store(index + 1, memory_order_release);
+}
+
+static double toMicroseconds(chrono::steady_clock::duration duration)
+{
+    return chrono::duration<double, micro>(duration).count();
+}
+
+// Writes the events still held in every thread's ring. Writing while other
+// threads record is allowed, and any event overwritten during the copy is
+// left out rather than exported half-written.
+bool Trace::writeJson(string filename)
+{
+    FILE* file = fopen(filename.c_str(), "w");
+    if(file == NULL)
+        return false;
+
+    lock_guard<mutex> lock(buffersMutex);
+
+    fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    bool first = true;
+    for(TraceBuffer* buffer : buffers)
+    {
+        fprintf(file, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": {\"name\": ", first ? "" : ",\n", buffer->threadId);
+        JsonWriter::writeString(file, buffer->threadName);
+        fprintf(file, "}}");
+        first = false;
+
+        size_t end = buffer->written.load(memory_order_acquire);
+        size_t begin = end > traceBufferEvents ? end - traceBufferEvents : 0;
+
+        vector<TraceEvent> events;
+        for(size_t i = begin; i < end; i++)
+        {
+            events.push_back(buffer->events[i % traceBufferEvents]);
+        }
+
+        // The slot of the event being recorded now may already be half
+        // overwritten, so it is left out too
+        size_t written = buffer->written.load(memory_order_acquire);
+        size_t overwritten = written + 1 > traceBufferEvents ? written + 1 - traceBufferEvents : 0;
+
+        for(size_t i = max(begin, overwritten); i < end; i++)
+        {
+            TraceEvent& event = events[i - begin];
+            fprintf(file, ",\n{\"name\": ");
+            JsonWriter::writeString(file, event.name);
+            fprintf(file, ", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f",
+                    buffer->threadId, toMicroseconds(event.start - traceStart), toMicroseconds(event.end - event.start));
+            if(event.detail[0] != '\0')
+            {
+                fprintf(file, ", \"args\": {\"detail\": ");
+                JsonWriter::writeString(file, event.detail);
+                fprintf(file, "}");
+            }
+            fprintf(file, "}");
+        }
+    }
+    fprintf(file, "\n]}\n");
+
+    return fclose(file) == 0;
+}
+
+// Events lost because a thread's ring wrapped before they were written out
+size_t Trace::getDroppedEvents()
+{
+    lock_guard<mutex> lock(buffersMutex);
+
+    size_t dropped = 0;
+    for(TraceBuffer* buffer : buffers)
+    {
+        size_t written = buffer->written.load(memory_order_acquire);
+        if(written > traceBufferEvents)
+        {
+            dropped += written - traceBufferEvents;
+        }
+    }
+    return dropped;
+}
+
+TraceZone::TraceZone(const char* newName, const char* newDetail)
+{
+    name = newName;
+    detail = newDetail;
+    start = chrono::steady_clock::now();
+}
+
+TraceZone::~TraceZone()
+{
+    Trace::addEvent(name, detail, start, chrono::steady_clock::now());
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+
+using namespace std;
+
+// Scoped CPU trace zones, recorded per thread and exported as Chrome trace
+// JSON for chrome://tracing or Perfetto. Zones are only recorded when built
+// with -DENABLE_TRACING, and otherwise the macros compile to nothing.
+#ifdef ENABLE_TRACING
+#define TRACE_CONCATENATE_LINE(a, b) a##b
+#define TRACE_VARIABLE(line) TRACE_CONCATENATE_LINE(traceZone, line)
+#define TRACE_ZONE(name) TraceZone TRACE_VARIABLE(__LINE__)(name, NULL)
+#define TRACE_ZONE_DETAIL(name, detail) TraceZone TRACE_VARIABLE(__LINE__)(name, detail)
+#define TRACE_EVENT(name, start, end) Trace::addEvent(name, NULL, start, end)
+#define TRACE_THREAD_NAME(name) Trace::setThreadName(name)
+#else
+#define TRACE_ZONE(name)
+#define TRACE_ZONE_DETAIL(name, detail)
+#define TRACE_EVENT(name, start, end)
+#define TRACE_THREAD_NAME(name)
+#endif
+
+struct TraceEvent
+{
+    const char* name;
+    char detail[64];
+    chrono::steady_clock::time_point start;
+    chrono::steady_clock::time_point end;
+};
+
+class Trace
+{
+    public:
+        static bool isEnabled();
+
+        static void setThreadName(string name);
+        static void addEvent(const char* name, const char* detail, chrono::steady_clock::time_point start, chrono::steady_clock::time_point end);
+
+        static bool writeJson(string filename);
+        static size_t getDroppedEvents();
+};
+
+// Names must be string literals, since only the pointer is kept. Details
+// are copied, keeping their end if too long to fit the event.
+class TraceZone
+{
+    public:
+        TraceZone(const char* newName, const char* newDetail);
+        ~TraceZone();
+
+    private:
+        const char* name;
+        const char* detail;
+        chrono::steady_clock::time_point start;
+};
@@ -0,0 +1,299 @@
+#include "vertexformat.h"
+#include "model.h"
+
+#include <cmath>
+#include <cstring>
+#include <stdint.h>
+
+VertexFormat::VertexFormat()
+{
+    setLayout(VERTEX_LAYOUT_SEPARATE);
+}
+
+void VertexFormat::addAttribute(GLuint location, GLint components, GLenum type, GLboolean normalized, int buffer, GLuint offset)
+{
+    VertexAttribute attribute = {location, components, type, normalized, buffer, offset};
+    attributes.push_back(attribute);
+}
+
+void VertexFormat::setLayout(VertexLayout newLayout)
+{
+    layout = newLayout;
+    attributes.clear();
+
+    if(layout == VERTEX_LAYOUT_COMPRESSED)
+    {
+        // unorm16 position (padded to 8 bytes), octahedral snorm16 normal
+        // and unorm16 texture coordinate in one 16 byte vertex
+        bufferCount = 1;
+        strides[0] = 16;
+
+        addAttribute(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, 0, 0);
+        addAttribute(1, 2, GL_SHORT, GL_TRUE, 0, 8);
+        addAttribute(2, 2, GL_UNSIGNED_SHORT, GL_TRUE, 0, 12);
+    }
+    else if(layout == VERTEX_LAYOUT_INTERLEAVED)
+    {
+        // position, normal, texture coordinate in one 32 byte vertex
+        bufferCount = 1;
+        strides[0] = 8 * sizeof(GLfloat);
+
+        addAttribute(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
+        addAttribute(1, 3, GL_FLOAT, GL_FALSE, 0, 3 * sizeof(GLfloat));
+        addAttribute(2, 2, GL_FLOAT, GL_FALSE, 0, 6 * sizeof(GLfloat));
+    }
+    else
+    {
+        bufferCount = 3;
+        strides[0] = 3 * sizeof(GLfloat);
+        strides[1] = 3 * sizeof(GLfloat);
+        strides[2] = 2 * sizeof(GLfloat);
+
+        addAttribute(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
+        addAttribute(1, 3, GL_FLOAT, GL_FALSE, 1, 0);
+        addAttribute(2, 2, GL_FLOAT, GL_FALSE, 2, 0);
+    }
+}
+
+VertexLayout VertexFormat::getLayout()
+{
+    return layout;
+}
+
+int VertexFormat::getBufferCount()
+{
+    return bufferCount;
+}
+
+GLsizei VertexFormat::getStride(int buffer)
+{
+    return strides[buffer];
+}
+
+vector<VertexAttribute>& VertexFormat::getAttributes()
+{
+    return attributes;
+}
+
+static inline float clampUnit(float value, float low)
+{
+    return value < low ? low : (value > 1.0f ? 1.0f : value);
+}
+
+static inline uint16_t quantizeUnorm16(float value)
+{
+    return (uint16_t) lroundf(clampUnit(value, 0.0f) * 65535.0f);
+}
+
+static inline int16_t quantizeSnorm16(float value)
+{
+    return (int16_t) lroundf(clampUnit(value, -1.0f) * 32767.0f);
+}
+
+static inline float signNotZero(float value)
+{
+    return value < 0.0f ? -1.0f : 1.0f;
+}
+
+static void encodeOctahedral(const float* normal, float* encoded)
+{
+    float length = fabsf(normal[0]) + fabsf(normal[1]) + fabsf(normal[2]);
+    if(length == 0.0f)
+    {
+        encoded[0] = 0.0f;
+        encoded[1] = 0.0f;
+        return;
+    }
+
+    float x = normal[0] / length;
+    float y = normal[1] / length;
+    if(normal[2] < 0.0f)
+    {
+        float foldedX = (1.0f - fabsf(y)) * signNotZero(x);
+        float foldedY = (1.0f - fabsf(x)) * signNotZero(y);
+        x = foldedX;
+        y = foldedY;
+    }
+
+    encoded[0] = x;
+    encoded[1] = y;
+}
+
+// Mirrors decodeOctahedral() in shaders/main_vertex.glsl
+static void decodeOctahedral(const float* encoded, float* normal)
+{
+    float x = encoded[0];
+    float y = encoded[1];
+    float z = 1.0f - fabsf(x) - fabsf(y);
+    if(z < 0.0f)
+    {
+        float unfoldedX = (1.0f - fabsf(y)) * signNotZero(x);
+        float unfoldedY = (1.0f - fabsf(x)) * signNotZero(y);
+        x = unfoldedX;
+        y = unfoldedY;
+    }
+
+    float length = sqrtf(x * x + y * y + z * z);
+    normal[0] = x / length;
+    normal[1] = y / length;
+    normal[2] = z / length;
+}
+
+void VertexFormat::buildCompressedBuffer(MeshData& mesh, vector<unsigned char>& storage, VertexQuantization& quantization)
+{
+    size_t vertexCount = mesh.vertices.size() / 3;
+
+    // Positions and texture coordinates are stored relative to their
+    // bounding range, which the vertex shader undoes with a scale/offset
+    for(int i = 0; i < 3; i++)
+    {
+        float range = mesh.boundsMax[i] - mesh.boundsMin[i];
+        quantization.positionScale[i] = range > 0.0f ? range : 1.0f;
+        quantization.positionOffset[i] = mesh.boundsMin[i];
+    }
+
+    for(int i = 0; i < 2; i++)
+    {
+        float low = mesh.textureCoordinates[i];
+        float high = low;
+        for(size_t vertex = 0; vertex < vertexCount; vertex++)
+        {
+            low = fminf(low, mesh.textureCoordinates[vertex * 2 + i]);
+            high = fmaxf(high, mesh.textureCoordinates[vertex * 2 + i]);
+        }
+        quantization.textureScale[i] = high > low ? high - low : 1.0f;
+        quantization.textureOffset[i] = low;
+    }
+
+    quantization.maxPositionError = 0.0f;
+    quantization.maxNormalError = 0.0f;
+    quantization.maxTextureError = 0.0f;
+
+    storage.resize(vertexCount * strides[0]);
+
+    for(size_t vertex = 0; vertex < vertexCount; vertex++)
+    {
+        unsigned char* destination = storage.data() + vertex * strides[0];
+
+        uint16_t position[4] = {0, 0, 0, 0};
+        for(int i = 0; i < 3; i++)
+        {
+            float original = mesh.vertices[vertex * 3 + i];
+            position[i] = quantizeUnorm16((original - quantization.positionOffset[i]) / quantization.positionScale[i]);
+
+            float decoded = position[i] / 65535.0f * quantization.positionScale[i] + quantization.positionOffset[i];
+            quantization.maxPositionError = fmaxf(quantization.maxPositionError, fabsf(decoded - original));
+        }
+
+        float encoded[2];
+        encodeOctahedral(&mesh.normals[vertex * 3], encoded);
+
+        int16_t normal[2];
+        float decodedEncoding[2];
+        for(int i = 0; i < 2; i++)
+        {
+            normal[i] = quantizeSnorm16(encoded[i]);
+            decodedEncoding[i] = fmaxf(normal[i] / 32767.0f, -1.0f);
+        }
+
+        float decodedNormal[3];
+        decodeOctahedral(decodedEncoding, decodedNormal);
+
+        float originalNormal[3];
+        float originalLength = sqrtf(mesh.normals[vertex * 3] * mesh.normals[vertex * 3] +
+                                     mesh.normals[vertex * 3 + 1] * mesh.normals[vertex * 3 + 1] +
+                                     mesh.normals[vertex * 3 + 2] * mesh.normals[vertex * 3 + 2]);
+        for(int i = 0; i < 3; i++)
+        {
+            originalNormal[i] = originalLength > 0.0f ? mesh.normals[vertex * 3 + i] / originalLength : 0.0f;
+            quantization.maxNormalError = fmaxf(quantization.maxNormalError, fabsf(decodedNormal[i] - originalNormal[i]));
+        }
+
+        uint16_t textureCoordinate[2];
+        for(int i = 0; i < 2; i++)
+        {
+            float original = mesh.textureCoordinates[vertex * 2 + i];
+            textureCoordinate[i] = quantizeUnorm16((original - quantization.textureOffset[i]) / quantization.textureScale[i]);
+
+            float decoded = textureCoordinate[i] / 65535.0f * quantization.textureScale[i] + quantization.textureOffset[i];
+            quantization.maxTextureError = fmaxf(quantization.maxTextureError, fabsf(decoded - original));
+        }
+
+        memcpy(destination + 0, position, sizeof(position));
+        memcpy(destination + 8, normal, sizeof(normal));
+        memcpy(destination + 12, textureCoordinate, sizeof(textureCoordinate));
+    }
+}
+
+void VertexFormat::buildBuffers(MeshData& mesh, vector<unsigned char>& storage, const void* bufferData[maxBuffers], GLsizeiptr bufferSizes[maxBuffers], VertexQuantization& quantization)
+{
+    size_t vertexCount = mesh.vertices.size() / 3;
+
+    for(int i = 0; i < 3; i++)
+    {
+        quantization.positionScale[i] = 1.0f;
+        quantization.positionOffset[i] = 0.0f;
+    }
+    for(int i = 0; i < 2; i++)
+    {
+        quantization.textureScale[i] = 1.0f;
+        quantization.textureOffset[i] = 0.0f;
+    }
+    quantization.maxPositionError = 0.0f;
+    quantization.maxNormalError = 0.0f;
+    quantization.maxTextureError = 0.0f;
+
+    if(layout == VERTEX_LAYOUT_COMPRESSED)
+    {
+        buildCompressedBuffer(mesh, storage, quantization);
+
+        bufferData[0] = storage.data();
+        bufferSizes[0] = storage.size();
+    }
+    else if(layout == VERTEX_LAYOUT_INTERLEAVED)
+    {
+        storage.resize(vertexCount * strides[0]);
+
+        GLfloat* destination = (GLfloat*) storage.data();
+        for(size_t i = 0; i < vertexCount; i++)
+        {
+            memcpy(destination + 0, &mesh.vertices[i * 3], 3 * sizeof(GLfloat));
+            memcpy(destination + 3, &mesh.normals[i * 3], 3 * sizeof(GLfloat));
+            memcpy(destination + 6, &mesh.textureCoordinates[i * 2], 2 * sizeof(GLfloat));
+            destination += 8;
+        }
+
+        bufferData[0] = storage.data();
+        bufferSizes[0] = storage.size();
+    }
+    else
+    {
+        // The parsed streams already have this layout, so use them in place
+        bufferData[0] = mesh.vertices.data();
+        bufferData[1] = mesh.normals.data();
+        bufferData[2] = mesh.textureCoordinates.data();
+
+        bufferSizes[0] = vertexCount * strides[0];
+        bufferSizes[1] = vertexCount * strides[1];
+        bufferSizes[2] = vertexCount * strides[2];
+    }
+}
+
+// Each vertex buffer gets the binding point of the same number, so the
+// VAO is set up without binding it or any buffer
+void VertexFormat::setupAttributes(GLuint vao, GLuint vertexBuffers[maxBuffers])
+{
+    for(int i = 0; i < bufferCount; i++)
+    {
+        glVertexArrayVertexBuffer(vao, i, vertexBuffers[i], 0, strides[i]);
+    }
+
+    for(int i = 0; i < (int) attributes.size(); i++)
+    {
+        VertexAttribute& attribute = attributes[i];
+
+        glEnableVertexArrayAttrib(vao, attribute.location);
+        glVertexArrayAttribFormat(vao, attribute.location, attribute.components, attribute.type, attribute.normalized, attribute.offset);
+        glVertexArrayAttribBinding(vao, attribute.location, attribute.buffer);
+    }
+}
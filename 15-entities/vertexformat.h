@@ -0,0 +1,64 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <vector>
+
+using namespace std;
+
+struct MeshData;
+
+enum VertexLayout
+{
+    VERTEX_LAYOUT_SEPARATE,
+    VERTEX_LAYOUT_INTERLEAVED,
+    VERTEX_LAYOUT_COMPRESSED
+};
+
+struct VertexQuantization
+{
+    float positionScale[3];
+    float positionOffset[3];
+    float textureScale[2];
+    float textureOffset[2];
+
+    float maxPositionError;
+    float maxNormalError;
+    float maxTextureError;
+};
+
+struct VertexAttribute
+{
+    GLuint location;
+    GLint components;
+    GLenum type;
+    GLboolean normalized;
+    int buffer;
+    GLuint offset;
+};
+
+class VertexFormat
+{
+    public:
+        static const int maxBuffers = 3;
+
+        VertexFormat();
+
+        void setLayout(VertexLayout newLayout);
+        VertexLayout getLayout();
+
+        int getBufferCount();
+        GLsizei getStride(int buffer);
+        vector<VertexAttribute>& getAttributes();
+
+        void buildBuffers(MeshData& mesh, vector<unsigned char>& storage, const void* bufferData[maxBuffers], GLsizeiptr bufferSizes[maxBuffers], VertexQuantization& quantization);
+        void setupAttributes(GLuint vao, GLuint vertexBuffers[maxBuffers]);
+
+    private:
+        VertexLayout layout;
+        int bufferCount;
+        GLsizei strides[maxBuffers];
+        vector<VertexAttribute> attributes;
+
+        void addAttribute(GLuint location, GLint components, GLenum type, GLboolean normalized, int buffer, GLuint offset);
+        void buildCompressedBuffer(MeshData& mesh, vector<unsigned char>& storage, VertexQuantization& quantization);
+};
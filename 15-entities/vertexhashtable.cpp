@@ -0,0 +1,99 @@
+#include "vertexhashtable.h"
+
+#include <stdint.h>
+
+VertexHashTable::VertexHashTable()
+{
+    mask = 0;
+    size = 0;
+}
+
+void VertexHashTable::reserve(size_t expectedElements)
+{
+    // Keep the load factor at or below one half so probe sequences stay short
+    size_t capacity = 16;
+    while(capacity < expectedElements * 2)
+    {
+        capacity *= 2;
+    }
+
+    if(capacity > slots.size())
+    {
+        grow(capacity);
+    }
+}
+
+void VertexHashTable::clear()
+{
+    slots.clear();
+    mask = 0;
+    size = 0;
+}
+
+size_t VertexHashTable::hash(GLuint vertexIndex, GLuint textureIndex, GLuint normalIndex)
+{
+    uint64_t key = ((uint64_t) vertexIndex << 32) ^ ((uint64_t) textureIndex << 16) ^ normalIndex;
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return (size_t) key;
+}
+
+void VertexHashTable::grow(size_t newCapacity)
+{
+    vector<Slot> oldSlots;
+    oldSlots.swap(slots);
+
+    Slot empty = {0, 0, 0, emptySlot};
+    slots.assign(newCapacity, empty);
+    mask = newCapacity - 1;
+
+    for(size_t i = 0; i < oldSlots.size(); i++)
+    {
+        if(oldSlots[i].element == emptySlot)
+            continue;
+
+        size_t position = hash(oldSlots[i].vertexIndex, oldSlots[i].textureIndex, oldSlots[i].normalIndex) & mask;
+        while(slots[position].element != emptySlot)
+        {
+            position = (position + 1) & mask;
+        }
+        slots[position] = oldSlots[i];
+    }
+}
+
+GLuint VertexHashTable::findOrInsert(GLuint vertexIndex, GLuint textureIndex, GLuint normalIndex, GLuint newElement, bool& inserted)
+{
+    if((size + 1) * 2 > slots.size())
+    {
+        grow(slots.empty() ? 16 : slots.size() * 2);
+    }
+
+    size_t position = hash(vertexIndex, textureIndex, normalIndex) & mask;
+    while(slots[position].element != emptySlot)
+    {
+        Slot& slot = slots[position];
+        if(slot.vertexIndex == vertexIndex && slot.textureIndex == textureIndex && slot.normalIndex == normalIndex)
+        {
+            inserted = false;
+            return slot.element;
+        }
+        position = (position + 1) & mask;
+    }
+
+    slots[position].vertexIndex = vertexIndex;
+    slots[position].textureIndex = textureIndex;
+    slots[position].normalIndex = normalIndex;
+    slots[position].element = newElement;
+    size++;
+
+    inserted = true;
+    return newElement;
+}
+
+size_t VertexHashTable::getSize()
+{
+    return size;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <vector>
+
+using namespace std;
+
+class VertexHashTable
+{
+    public:
+        VertexHashTable();
+
+        void reserve(size_t expectedElements);
+        void clear();
+
+        GLuint findOrInsert(GLuint vertexIndex, GLuint textureIndex, GLuint normalIndex, GLuint newElement, bool& inserted);
+        size_t getSize();
+
+    private:
+        struct Slot
+        {
+            GLuint vertexIndex;
+            GLuint textureIndex;
+            GLuint normalIndex;
+            GLuint element;
+        };
+
+        vector<Slot> slots;
+        size_t mask;
+        size_t size;
+
+        static const GLuint emptySlot = 0xffffffff;
+
+        size_t hash(GLuint vertexIndex, GLuint textureIndex, GLuint normalIndex);
+        void grow(size_t newCapacity);
+};